@@ -2,8 +2,19 @@
 #include <Wire.h>
 #include "config.h"
 #include "audio.h"
+#include "dial.h"
+#include "governor.h"
+#include "health.h"
 #include "input.h"
+#include "latency.h"
+#include "library.h"
+#include "playlist.h"
 #include "power.h"
+#include "reconcile.h"
+#include "resume.h"
+#include "settings.h"
+#include "sleeptimer.h"
+#include "trackstats.h"
 #include "ui.h"
 
 static unsigned long lastBatteryRead = 0;
@@ -14,6 +25,26 @@ static unsigned long rtcFallbackStart = 0;
 static bool manualTimeSet = false;
 static uint16_t manualStartMinutes = 0;
 
+// Settings selector, opened by holding Play for SETTINGS_HOLD_MS. While it is
+// up Next/Prev change the value, a Play tap moves to the next field and a Play
+// hold closes it; the volume keys keep working so an EQ can be judged at a
+// useful level. NVS is written once, on close.
+static bool settingsOpen = false;
+static SettingsField settingsField = SettingsField::Eq;
+static unsigned long settingsTouchedAt = 0;
+
+// Track dial, opened and cancelled with a Prev+Next chord. Prev/Next move
+// between digits, the volume keys (with repeat) turn the selected digit and a
+// Play tap plays the dialled track with a single command.
+static bool dialOpen = false;
+static unsigned long dialTouchedAt = 0;
+
+// Sleep timer expiry: fade out over SLEEP_FADE_MS and pause, then sleep the
+// panel and light-sleep the CPU once the link is quiet. Any input during the
+// fade cancels it; a touch while asleep wakes up and resumes the same track.
+static bool sleepFading = false;
+static bool sleepPaused = false; // playback was paused by the timer
+
 static uint8_t bcdToDec(uint8_t val) {
   return ((val / 16) * 10) + (val % 16);
 }
@@ -58,10 +89,7 @@ static ClockTime rtcNow() {
   return t;
 }
 
-static void handleSerialTime() {
-  if (!Serial.available()) return;
-  String line = Serial.readStringUntil('\n');
-  line.trim();
+static void handleSerialTime(const String &line) {
   if (line.length() < 4) return;
   int sep = line.indexOf(':');
   if (sep < 0) return;
@@ -75,12 +103,288 @@ static void handleSerialTime() {
   }
 }
 
+// `pl` prints the play order; `pl add [N]` appends track N (default: the one
+// playing) to the working list, `pl play` starts it, `pl save S` / `pl load S`
+// store it in or play it from NVS slot S, `pl clear` empties it, `pl fav` /
+// `pl top` replace it with the favourites / most played tracks and play them.
+// `next N` plays track N after the current one, `queue N` after everything
+// queued.
+static void handlePlaylistCommand(const String &line) {
+  int space = line.lastIndexOf(' ');
+  bool numeric = space > 0 && isDigit(line.charAt(space + 1));
+  String verb = numeric ? line.substring(0, space) : line;
+  long arg = numeric ? line.substring(space + 1).toInt() : -1;
+  uint16_t current = getAudioStatus().track;
+  bool ok = true;
+  if (verb == "pl add") {
+    ok = playlistAppend(arg > 0 ? arg : current);
+  } else if (verb == "pl play") {
+    ok = audioPlaylistPlay(-1);
+  } else if (verb == "pl save") {
+    ok = arg >= 0 && playlistSave(arg);
+  } else if (verb == "pl load") {
+    ok = arg >= 0 && audioPlaylistPlay(arg);
+  } else if (verb == "pl clear") {
+    playlistClear();
+  } else if (verb == "pl fav" || verb == "pl top") {
+    ok = audioPlayStats(verb == "pl fav");
+  } else if (verb == "next") {
+    ok = arg > 0 && playlistPlayNext(arg);
+  } else if (verb == "queue") {
+    ok = arg > 0 && playlistEnqueue(arg);
+  }
+  if (!ok) Serial.println("playlist: rejected");
+  playlistPrintStats(Serial);
+}
+
+static void closeSettings() {
+  settingsOpen = false;
+  uiHideSettings();
+  settingsSave();
+}
+
+// Returns true when the selector consumed the event.
+static bool handleSettingsInput(InputEvent ev, unsigned long now) {
+  if (!settingsOpen) {
+    if (ev != InputEvent::SettingsOpen || currentMode != UIMode::DFP) return false;
+    settingsOpen = true;
+    settingsField = SettingsField::Eq;
+    settingsTouchedAt = now;
+    uiShowSettings(settingsField);
+    return true;
+  }
+  if (ev == InputEvent::None) {
+    if (now - settingsTouchedAt >= UI_SETTINGS_IDLE_MS) closeSettings();
+    return false;
+  }
+  settingsTouchedAt = now;
+  switch (ev) {
+    case InputEvent::Next:
+    case InputEvent::NextFolder:
+    case InputEvent::Prev:
+    case InputEvent::FavoriteToggle:
+      if (settingsStep(settingsField, ev == InputEvent::Prev || ev == InputEvent::FavoriteToggle ? -1 : 1)) audioSettingsChanged();
+      break;
+    case InputEvent::PlayPause:
+      settingsField = static_cast<SettingsField>((static_cast<uint8_t>(settingsField) + 1) % SETTINGS_FIELD_COUNT);
+      break;
+    case InputEvent::ShuffleToggle:
+    case InputEvent::SettingsOpen:
+      closeSettings();
+      return true;
+    default:
+      // Volume keys and the mode combo keep their meaning; a mode switch closes the selector.
+      if (ev == InputEvent::ModeToggle) closeSettings();
+      return false;
+  }
+  uiShowSettings(settingsField);
+  return true;
+}
+
+static void closeDial() {
+  dialOpen = false;
+  uiHideDial();
+}
+
+static void resumeAfterSleep() {
+  if (sleepPaused) audioTogglePause(); // also turns an unfinished fade around
+  sleepPaused = false;
+}
+
+static void startSleep() {
+  if (dialOpen) closeDial();
+  if (settingsOpen) closeSettings();
+  sleepPaused = currentMode == UIMode::DFP && audioFadeToPause(SLEEP_FADE_MS);
+  sleepFading = true;
+  uiPulse("SLEEP");
+}
+
+// Returns true when the event only served to cancel a pending sleep.
+static bool handleSleepInput(InputEvent ev) {
+  if (sleepTimerExpired()) startSleep();
+  if (!sleepFading || ev == InputEvent::None) return false;
+  sleepFading = false;
+  resumeAfterSleep();
+  uiPulse("AWAKE");
+  return true;
+}
+
+static void enterSleep(unsigned long now) {
+  sleepFading = false;
+  resumeFlush(now);
+  uiPanelSleep();
+  inputArmWake();
+  sleepTimerNoteSlept(powerLightSleep());
+  inputWake();
+  governorNoteActivity(); // wakes the panel on the next frame
+  resumeAfterSleep();
+}
+
+// Returns true when the dial consumed the event.
+static bool handleDialInput(InputEvent ev, unsigned long now) {
+  if (!dialOpen) {
+    if (ev != InputEvent::TrackDial || currentMode != UIMode::DFP || settingsOpen) return false;
+    AudioStatus audio = getAudioStatus();
+    if (!audio.online) return true;
+    dialOpen = true;
+    dialTouchedAt = now;
+    dialBegin(audio.track, audio.trackCount);
+    uiShowDial();
+    return true;
+  }
+  if (ev == InputEvent::None) {
+    if (now - dialTouchedAt >= UI_DIAL_IDLE_MS) closeDial();
+    return false;
+  }
+  dialTouchedAt = now;
+  switch (ev) {
+    case InputEvent::VolUp:
+    case InputEvent::VolDown:
+      dialStep(ev == InputEvent::VolUp ? 1 : -1);
+      break;
+    case InputEvent::Next:
+    case InputEvent::NextFolder:
+    case InputEvent::Prev:
+    case InputEvent::FavoriteToggle:
+      dialMove(ev == InputEvent::Prev || ev == InputEvent::FavoriteToggle ? -1 : 1);
+      break;
+    case InputEvent::PlayPause:
+      if (audioJumpTo(dialValue())) uiPulse("TRACK");
+      closeDial();
+      break;
+    case InputEvent::ModeToggle:
+      closeDial();
+      return false;
+    default:
+      closeDial(); // the chord again, or a Play hold, cancels
+      break;
+  }
+  return true;
+}
+
+// Serial console: `HH:MM` sets the clock, `fps` dumps frame governor stats,
+// `power` dumps time spent in each panel power state, `fx` dumps line effect
+// cost, `fx scan`/`fx noscan` toggle scanlines and `df` dumps DFPlayer link stats.
+// `lat` prints input-to-audio latency histograms, `lat reset` clears them.
+// `eq` prints the audio settings, `eq N` selects EQ preset N (0 = normal ..
+// 5 = bass) and `out` switches between the speaker and headphone profiles.
+// Lines are assembled from whatever bytes are already buffered, so loop()
+// never waits on the console UART.
+static void handleSerialCommand() {
+  static char lineBuf[32];
+  static uint8_t lineLen = 0;
+  bool complete = false;
+  while (Serial.available() > 0 && !complete) {
+    char c = static_cast<char>(Serial.read());
+    if (c == '\n') {
+      complete = true;
+    } else if (lineLen < sizeof(lineBuf) - 1) {
+      lineBuf[lineLen++] = c;
+    }
+  }
+  if (!complete) return;
+  lineBuf[lineLen] = '\0';
+  lineLen = 0;
+  String line(lineBuf);
+  line.trim();
+  if (line == "fps") {
+    governorPrintStats(Serial);
+    return;
+  }
+  if (line == "power") {
+    uiPrintPowerStats(Serial);
+    return;
+  }
+  if (line == "df") {
+    audioPrintStats(Serial);
+    return;
+  }
+  if (line == "shuffle") {
+    // off -> on -> smart -> off
+    uint8_t next = (static_cast<uint8_t>(getAudioStatus().shuffle) + 1) % 3;
+    audioSetShuffle(static_cast<ShuffleMode>(next));
+    audioPrintStats(Serial);
+    return;
+  }
+  if (line == "repeat") {
+    // stop -> continue -> repeat-all -> repeat-one -> stop
+    uint8_t next = (static_cast<uint8_t>(audioEndOfTrack()) + 1) % 4;
+    audioSetEndOfTrack(static_cast<EndOfTrack>(next));
+    audioPrintStats(Serial);
+    return;
+  }
+  if (line == "health") {
+    healthPrintStats(Serial, millis());
+    reconcilePrintStats(Serial);
+    return;
+  }
+  if (line == "lib") {
+    libraryPrintStats(Serial);
+    return;
+  }
+  if (line == "album") {
+    audioNextFolder();
+    return;
+  }
+  if (line == "resume") {
+    resumePrintStats(Serial);
+    return;
+  }
+  if (line == "pl" || line.startsWith("pl ") || line.startsWith("next ") || line.startsWith("queue ")) {
+    handlePlaylistCommand(line);
+    return;
+  }
+  if (line == "eq" || line.startsWith("eq ") || line == "out") {
+    bool changed = false;
+    if (line == "out") {
+      changed = settingsStep(SettingsField::Output, 1);
+    } else if (line.length() > 3 && isDigit(line.charAt(3))) {
+      changed = settingsSetEq(line.substring(3).toInt());
+    }
+    if (changed) {
+      audioSettingsChanged();
+      settingsSave();
+    }
+    settingsPrintStats(Serial);
+    return;
+  }
+  if (line == "sleep" || line.startsWith("sleep ")) {
+    if (line.length() > 6) sleepTimerSet(line.substring(6).toInt());
+    sleepTimerPrintStats(Serial);
+    return;
+  }
+  if (line == "stats" || line == "fav") {
+    if (line == "fav") Serial.println(audioToggleFavorite() ? "favourite" : "not a favourite");
+    statsPrintStats(Serial);
+    return;
+  }
+  if (line == "lat" || line == "lat reset") {
+    if (line == "lat reset") latencyReset();
+    latencyPrintStats(Serial);
+    return;
+  }
+  if (line == "fx") {
+    uiPrintFxStats(Serial);
+    return;
+  }
+  if (line == "fx scan" || line == "fx noscan") {
+    uiSetScanlines(line == "fx scan");
+    return;
+  }
+  handleSerialTime(line);
+}
+
 void setup() {
   Serial.begin(115200);
   Serial.println("=== SPECTRA SETUP START ===");
   powerInit();
   inputInit();
+  resumeBegin();
+  ResumeState resumed;
+  if (resumeLoad(resumed) && resumed.uiMode == static_cast<uint8_t>(UIMode::BT)) currentMode = UIMode::BT;
   audioInit();
+  audioSetStandby(currentMode == UIMode::BT);
+  sleepTimerBegin();
   rtcInit();
   uiInit();
   cachedBattery = readBattery();
@@ -89,6 +393,9 @@ void setup() {
 
 void loop() {
   InputEvent ev = inputPoll();
+  bool input = ev != InputEvent::None;
+  if (input) governorNoteActivity();
+  if (handleSleepInput(ev) || handleDialInput(ev, millis()) || handleSettingsInput(ev, millis())) ev = InputEvent::None;
   switch (ev) {
     case InputEvent::PlayPause:
       if (currentMode == UIMode::DFP) {
@@ -96,18 +403,34 @@ void loop() {
         uiPulse("PLAYBACK");
       }
       break;
+    case InputEvent::ShuffleToggle:
+      if (currentMode == UIMode::DFP) {
+        uint8_t next = (static_cast<uint8_t>(getAudioStatus().shuffle) + 1) % 3;
+        audioSetShuffle(static_cast<ShuffleMode>(next));
+        uiPulse(next == static_cast<uint8_t>(ShuffleMode::Smart) ? "SMART SHUFFLE" : "SHUFFLE");
+      }
+      break;
     case InputEvent::Next:
       if (currentMode == UIMode::DFP) {
         audioNext();
         uiPulse("TRACK >>");
       }
       break;
+    case InputEvent::NextFolder:
+      if (currentMode == UIMode::DFP) {
+        audioNextFolder();
+        uiPulse("ALBUM >>");
+      }
+      break;
     case InputEvent::Prev:
       if (currentMode == UIMode::DFP) {
         audioPrev();
         uiPulse("TRACK <<");
       }
       break;
+    case InputEvent::FavoriteToggle:
+      if (currentMode == UIMode::DFP) uiPulse(audioToggleFavorite() ? "FAVOURITE" : "UNFAVOURITE");
+      break;
     case InputEvent::VolUp:
       if (currentMode == UIMode::DFP) {
         if (audioVolumeUp()) {
@@ -124,22 +447,34 @@ void loop() {
       break;
     case InputEvent::ModeToggle:
       currentMode = (currentMode == UIMode::DFP) ? UIMode::BT : UIMode::DFP;
+      audioSetStandby(currentMode == UIMode::BT);
       uiPulse("MODE");
       break;
     default:
       break;
   }
+  if (input) latencyMark(LatencyStage::Dispatch, micros());
 
   audioLoop();
-  handleSerialTime();
+  handleSerialCommand();
 
   unsigned long now = millis();
   if (now - lastBatteryRead > 2000) {
+    bool wasRed = cachedBattery.level == BatteryLevel::Red;
     cachedBattery = readBattery();
     lastBatteryRead = now;
+    // Brown-out may follow; get the latest state into NVS while we can.
+    if (!wasRed && cachedBattery.level == BatteryLevel::Red) resumeFlush(now);
   }
 
+  AudioStatus audio = getAudioStatus();
+  ResumeState resume{};
+  audioSnapshot(resume);
+  resume.uiMode = static_cast<uint8_t>(currentMode);
+  resumeUpdate(resume, audio.state == PlaybackState::Playing, now);
+  if (sleepFading && audioQuiet()) enterSleep(now);
+
   ClockTime nowClock = rtcNow();
-  uiUpdate(getAudioStatus(), cachedBattery, currentMode, nowClock);
+  uiUpdate(audio, cachedBattery, currentMode, nowClock);
 }
 
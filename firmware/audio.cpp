@@ -1,100 +1,899 @@
 #include "audio.h"
 
-#include <DFRobotDFPlayerMini.h>
+#include "audio_backend.h"
+#include "fade.h"
+#include "health.h"
+#include "library.h"
+#include "playlist.h"
+#include "reconcile.h"
+#include "resume.h"
+#include "settings.h"
+#include "trackstats.h"
 
-static HardwareSerial dfSerial(1);
-static DFRobotDFPlayerMini dfPlayer;
+// Link bring-up: wait for the module's power-on report (or DFPLAYER_BOOT_MS),
+// then probe the card with a file-count query. Replies arrive as events, so
+// nothing here ever waits on the UART. Playback of the resumed file starts as
+// soon as the card answers; the library scan follows in the background. With
+// the library shape cached in NVS the probe is skipped: playback starts on the
+// power-on report and the cache is verified behind it.
+//
+// health.cpp watches the link once it is Ready. When the module stops
+// answering (unplugged, browned out) the link drops to Absent and the same
+// file-count probe is retried on a backoff until it answers, after which
+// bring-up runs again and restores volume, file and play state.
+enum class LinkState : uint8_t {
+  Booting,
+  CountingFiles,
+  Ready,
+  Absent
+};
 
+// currentTrack numbers tracks across the library (see library.h);
+// currentLoc is the file it resolves to and what actually gets played.
 static uint16_t currentTrack = DEFAULT_TRACK;
+static TrackLocation currentLoc{0, DEFAULT_TRACK};
 static uint8_t currentVolume = DEFAULT_VOLUME;
 static PlaybackState playbackState = PlaybackState::Stopped;
 static bool initialized = false;
 static bool online = false;
 static uint16_t trackCount = 1;
-static unsigned long lastQuery = 0;
+static LinkState linkState = LinkState::Booting;
+static unsigned long bootStartedAt = 0;
+static bool everReady = false;          // the first bring-up always starts playback
+static bool playOnRecovery = false;     // was playing when the link or card went away
+static bool bootFromCache = false;
+static unsigned long firstAudioAt = 0;  // ack of the first play command, ms since power-on
 
-static uint16_t detectTrackCount() {
-  int16_t count = dfPlayer.readFileCounts();
-  if (count > 0) return static_cast<uint16_t>(count);
+// Until the library is known, skips are counted and end-of-track advances are
+// deferred; both are applied when the scan completes.
+static int16_t stepsBeforeLibrary = 0;
+static bool advanceWhenLibrary = false;
 
-  count = dfPlayer.readFileCountsInFolder(1);
-  if (count > 0) return static_cast<uint16_t>(count);
+// Play order, shuffle included, lives in playlist.cpp; the shuffle seed and
+// cursor travel with the resume state and are restored once the library is
+// known.
+static bool shuffleRestorePending = false;
+static ShuffleState savedShuffle{};
 
-  // Stable fallback: assume single track available
-  return 1;
+// Approximate position in the current track: play time accumulated before the
+// last pause plus time since the last start/resume.
+static uint32_t elapsedBeforeMs = 0;
+static unsigned long playingSince = 0;
+// Each track that starts is counted once when it is left: as a play if it
+// ran out or lasted STATS_PLAY_MS, as a skip otherwise.
+static bool statsCounted = false;
+
+// End of track. The module reports 0x3D twice, and a report can trail a play
+// command the user issued while the old track was running out, so reports
+// close to the last play or the last report are ignored.
+static EndOfTrack endPolicy = DEFAULT_END_OF_TRACK;
+static unsigned long lastPlayAt = 0;
+static unsigned long lastFinishAt = 0;
+static uint8_t failedPlays = 0;
+
+// End-of-track -> next-track latency: from the 0x3D report to the ack of the
+// play command it triggered.
+static bool advancePending = false;
+static unsigned long advanceFinishAt = 0;
+
+struct EndOfTrackStats {
+  uint32_t finished;
+  uint32_t ignored;
+  uint32_t advances;
+  uint32_t skipped;
+  uint32_t latencySamples;
+  uint32_t latencyLastMs;
+  uint32_t latencyMaxMs;
+  uint32_t latencyTotalMs;
+};
+static EndOfTrackStats eotStats{};
+
+// Intent coalescing. Next/Prev and volume presses update currentTrack and
+// currentVolume at once (the UI reads them), but the UART only carries the
+// outcome: the first tap of a skip burst plays immediately and the rest
+// collapse into one play command once the taps stop; a held volume key sends
+// at most one frame per window, always ending on the final level.
+static bool trackIntentPending = false;
+static unsigned long trackIntentAt = 0;
+static uint16_t trackBeforeIntent = 0;
+// The track a held burst left: the module keeps playing it until the burst
+// lands, so its play or skip is only counted if something else starts.
+struct BurstStart {
+  TrackLocation loc;
+  PlaybackState state;
+  bool statsCounted;
+  uint32_t elapsedBeforeMs;
+  unsigned long playingSince;
+};
+static BurstStart burstStart{};
+static bool volumeIntentPending = false;
+static unsigned long volumeSentAt = 0;
+static uint8_t sentVolume = 0;
+
+// Fades. Every start, pause and resume is wrapped in a volume ramp queued
+// as timed DFPlayer entries (fade.h); a new transition cancels whatever is
+// left of the previous one. moduleVolume follows the acks, so a ramp that is
+// cut short is picked up from the level the module actually reached.
+// Volume key changes wait while a ramp is in the queue or nothing is playing.
+static uint8_t moduleVolume = MAX_VOLUME;
+static bool modulePaused = false;
+
+// Audio settings. A settings edit caps the volume at once, but the EQ is only
+// sent once edits have stopped for AUDIO_SETTINGS_SETTLE_MS, so cycling
+// through the presets costs one frame. The module is back on Normal after
+// every power-up; bring-up sends anything else.
+static bool eqIntentPending = false;
+static unsigned long eqChangedAt = 0;
+static EqPreset sentEq = EqPreset::Normal;
+
+// Standby (BT mode): the module is left alone. A playing track fades out and
+// pauses first, then the engine runs on NullBackend (audio_backend.h) until
+// standby ends, when bring-up runs again on the module and the track starts
+// over if it was playing.
+static bool standbyWanted = false;
+static bool standbyResume = false;
+
+// Reconciliation (reconcile.h). A round's replies are only compared while
+// nothing else has been queued since it went out, so they describe the state
+// the local model still holds. The health ping's status reply is checked the
+// same way. The module numbers files in its own (FAT) order, which need not
+// match the library's, so the 0x4C answer is not compared with currentTrack:
+// the first answer after a play is learned as the index of that file, and a
+// later one that differs, or one that never moved off the file before it,
+// means the module is not playing what it was told to.
+static uint8_t roundReplies = 0; // still expected; 0 = no round open
+static bool roundFull = false;   // all three queries, not just a ping
+static bool roundClean = true;
+static uint32_t roundQueued = 0; // AudioBackend::stats().queued once the round was queued
+static uint16_t moduleTrack = 0;
+static bool moduleTrackKnown = false; // moduleTrack is the index of currentLoc
+static uint16_t trackBeforePlay = 0;  // module index before the last play, 0 = unknown
+static bool playMovedFile = false;
+
+struct CoalesceStats {
+  uint32_t trackIntents;
+  uint32_t trackSends;
+  uint32_t volumeIntents;
+  uint32_t volumeSends;
+  uint32_t eqIntents;
+  uint32_t eqSends;
+};
+static CoalesceStats coalesceStats{};
+
+static void sendVolume(unsigned long now) {
+  volumeIntentPending = false;
+  volumeSentAt = now;
+  if (currentVolume == sentVolume) return;
+  sentVolume = currentVolume;
+  AudioBackend::send(DfCmd::SetVolume, currentVolume);
+  coalesceStats.volumeSends++;
+  reconcileSoon(now);
 }
 
-void audioInit() {
-  dfSerial.begin(9600, SERIAL_8N1, PIN_DFPLAYER_TX, PIN_DFPLAYER_RX);
-  if (dfPlayer.begin(dfSerial)) {
-    initialized = true;
-    online = true;
-    trackCount = detectTrackCount();
-    if (trackCount == 0) trackCount = 1;
-    dfPlayer.volume(currentVolume);
-    currentTrack = constrain(currentTrack, (uint16_t)1, trackCount);
-    audioPlayTrack(currentTrack);
+static void sendEq() {
+  eqIntentPending = false;
+  EqPreset eq = settingsGet().eq;
+  if (eq == sentEq) return;
+  sentEq = eq;
+  AudioBackend::send(DfCmd::SetEq, static_cast<uint8_t>(eq));
+  coalesceStats.eqSends++;
+}
+
+static bool isPlayCommand(uint8_t command) {
+  return command == DfCmd::PlayMp3Folder || command == DfCmd::PlayFolder;
+}
+
+static bool volumeFree() {
+  return playbackState == PlaybackState::Playing && !AudioBackend::timedPending();
+}
+
+static void leaveTrack(bool finished) {
+  if (statsCounted || playbackState == PlaybackState::Stopped) return;
+  statsCounted = true;
+  if (finished || audioElapsedMs() >= STATS_PLAY_MS) {
+    statsNotePlay(currentLoc);
   } else {
-    initialized = false;
-    online = false;
-    trackCount = 1;
+    statsNoteSkip(currentLoc);
   }
 }
 
-void audioLoop() {
+// Fade out what is playing (or mute, if something might be audible), start
+// `loc` at zero and fade up to the current volume.
+static void playLocation(const TrackLocation &loc) {
+  leaveTrack(false);
+  statsCounted = false;
+  bool moved = loc.folder != currentLoc.folder || loc.file != currentLoc.file;
+  if (moduleTrackKnown) {
+    trackBeforePlay = moduleTrack;
+    playMovedFile = moved;
+  } else {
+    playMovedFile = playMovedFile || moved; // the previous play is not confirmed yet either
+  }
+  moduleTrackKnown = false;
+  currentLoc = loc;
+  AudioBackend::cancelTimed();
+  uint8_t level = moduleVolume;
+  uint16_t stepMs = 0;
+  // The fade-out leaves room for the play and the whole fade-in after it.
+  uint8_t reserve = 1 + fadeSteps(0, currentVolume, AUDIO_FADE_IN_MS);
+  if (AUDIO_FADE_OUT_MS > 0 && playbackState == PlaybackState::Playing) {
+    stepMs = fadeQueue(level, 0, AUDIO_FADE_OUT_MS, reserve);
+    level = 0;
+  }
+  if (AUDIO_FADE_IN_MS > 0 && level != 0) {
+    fadeQueue(level, 0, 0, reserve);
+    level = 0;
+  }
+  if (loc.folder == 0) {
+    AudioBackend::sendAfter(DfCmd::PlayMp3Folder, loc.file, stepMs);
+  } else {
+    AudioBackend::sendAfter(DfCmd::PlayFolder, (static_cast<uint16_t>(loc.folder) << 8) | (loc.file & 0xFF), stepMs);
+  }
+  fadeQueue(level, currentVolume, AUDIO_FADE_IN_MS);
+  sentVolume = currentVolume;
+  playbackState = PlaybackState::Playing;
+  lastPlayAt = millis();
+  elapsedBeforeMs = 0;
+  playingSince = lastPlayAt;
+  reconcileSoon(lastPlayAt);
+}
+
+static void startTrack(uint16_t trackNumber) {
+  currentTrack = constrain(trackNumber, (uint16_t)1, trackCount);
+  if (initialized && libraryReady()) playLocation(libraryLocate(currentTrack));
+}
+
+static void libraryLoaded();
+
+static void linkReady(uint16_t count) {
+  bool known = libraryReady(); // cached in NVS or scanned before the link dropped
+  trackCount = known ? libraryTotal() : (count > 0 ? count : 1); // else provisional until the scan ends
+  initialized = true;
+  online = true;
+  linkState = LinkState::Ready;
+  moduleVolume = MAX_VOLUME; // unknown after power-up; assume audible so the first start mutes
+  modulePaused = false;
+  sentEq = EqPreset::Normal;
+  sendEq();
+  if (currentLoc.file == 0) currentLoc = TrackLocation{0, DEFAULT_TRACK};
+  if (known && libraryTrackOf(currentLoc) == 0) currentLoc = libraryLocate(1);
+  // The module cannot seek, so a recovered track restarts from its beginning.
+  if (!everReady || playOnRecovery) {
+    playLocation(currentLoc);
+  } else {
+    sentVolume = currentVolume;
+    AudioBackend::send(DfCmd::SetVolume, currentVolume);
+  }
+  everReady = true;
+  playOnRecovery = false;
+  unsigned long now = millis();
+  healthOnline(now);
+  if (known) {
+    libraryLoaded();
+    libraryVerifyStart(now);
+  } else {
+    libraryScanStart(count, now);
+  }
+}
+
+static void advanceAfterFinish(unsigned long finishedAt);
+
+// Tables became ready or changed: re-derive the track number from the file.
+static void libraryLoaded() {
+  trackCount = libraryTotal();
+  uint16_t track = libraryTrackOf(currentLoc);
+  bool playingElsewhere = track == 0; // resumed file is not part of this card's layout
+  currentTrack = playingElsewhere ? 1 : track;
+  bool restored = shuffleRestorePending && playlistRestoreShuffle(savedShuffle, currentTrack);
+  if (!restored) playlistSync(currentTrack);
+  shuffleRestorePending = false;
+
+  bool advance = advanceWhenLibrary;
+  advanceWhenLibrary = false;
+  if (stepsBeforeLibrary != 0) {
+    for (; stepsBeforeLibrary > 0; --stepsBeforeLibrary) audioNext();
+    for (; stepsBeforeLibrary < 0; ++stepsBeforeLibrary) audioPrev();
+  } else if (playingElsewhere) {
+    // Start over at the first track, unless playback had already stopped.
+    if (playbackState == PlaybackState::Playing || advance) audioPlayTrack(currentTrack);
+  } else if (advance) {
+    advanceAfterFinish(millis());
+  }
+}
+
+// The module lost whatever it was doing; remember what to put back. The
+// track, volume and shuffle order stay as they are so the UI keeps showing
+// them and the next bring-up can restore them.
+static void forgetModuleState() {
+  if (playbackState == PlaybackState::Playing) {
+    playOnRecovery = true;
+    elapsedBeforeMs = audioElapsedMs();
+  }
+  playbackState = PlaybackState::Stopped;
+  AudioBackend::flush();
+  trackIntentPending = false;
+  volumeIntentPending = false;
+  eqIntentPending = false; // bring-up sends the preset anyway
+  advancePending = false;
+  advanceWhenLibrary = false;
+  stepsBeforeLibrary = 0;
+  // The module may come back renumbered, and an open round will not finish.
+  moduleTrackKnown = false;
+  trackBeforePlay = 0;
+  playMovedFile = false;
+  if (roundReplies > 0 && roundFull) reconcileVoided(millis());
+  roundReplies = 0;
+  if (playlistShuffleMode() == ShuffleMode::Plain && !shuffleRestorePending && libraryReady()) {
+    savedShuffle = playlistShuffleState();
+    shuffleRestorePending = true;
+  }
+}
+
+static void linkAbsent(unsigned long now) {
+  if (linkState == LinkState::Ready) forgetModuleState();
+  initialized = false;
+  online = false;
+  linkState = LinkState::Absent;
+  healthOffline(now);
+}
+
+static void probeCard() {
+  linkState = LinkState::CountingFiles;
+  AudioBackend::send(DfCmd::QueryTfFiles);
+}
+
+// Card reseated, or the module rebooted on its own: its file count may have
+// changed, so bring-up runs again without waiting for a backoff.
+static void relink() {
+  forgetModuleState();
+  initialized = false;
+  probeCard();
+}
+
+static void handleLinkEvent(const DfEvent &ev) {
+  bool failed = ev.type == DfEventType::Timeout || ev.type == DfEventType::Error;
+  switch (linkState) {
+    case LinkState::CountingFiles:
+      if (ev.command != DfCmd::QueryTfFiles) return;
+      if (ev.type == DfEventType::Timeout) {
+        linkAbsent(ev.at);
+      } else if (ev.type == DfEventType::Reply || failed) {
+        linkReady(ev.type == DfEventType::Reply ? ev.param : 0);
+      }
+      break;
+    case LinkState::Absent:
+      // Anything the module sends means it is back; a late timeout does not.
+      if (ev.type != DfEventType::Timeout) healthRetryNow(ev.at);
+      break;
+    default:
+      break;
+  }
+}
+
+// Track to play after the current one ends; false means stop here.
+static bool trackAfter(uint16_t &track) {
+  switch (endPolicy) {
+    case EndOfTrack::RepeatOne:
+      track = currentTrack;
+      return true;
+    case EndOfTrack::RepeatAll:
+      return playlistNext(true, track);
+    case EndOfTrack::Continue:
+      return playlistNext(false, track);
+    default:
+      return false;
+  }
+}
+
+static void handleTrackFinished(const DfEvent &ev) {
+  if (ev.at - lastPlayAt < DFPLAYER_FINISH_DEDUPE_MS || ev.at - lastFinishAt < DFPLAYER_FINISH_DEDUPE_MS) {
+    eotStats.ignored++;
+    return;
+  }
+  lastFinishAt = ev.at;
+  eotStats.finished++;
+  if (playbackState == PlaybackState::Paused && AudioBackend::timedPending()) {
+    // Ran out while fading towards a pause (the sleep timer's fade is long):
+    // nothing is left to resume, so line up what would have followed for the
+    // next Play instead.
+    leaveTrack(true);
+    AudioBackend::cancelTimed();
+    playbackState = PlaybackState::Stopped;
+    uint16_t next;
+    if (libraryReady() && trackAfter(next)) {
+      currentTrack = next;
+      currentLoc = libraryLocate(next);
+    }
+    return;
+  }
+  if (playbackState != PlaybackState::Playing) return;
+  if (trackIntentPending) return; // the user already picked what plays next
+  leaveTrack(true);
+  if (!libraryReady()) {
+    advanceWhenLibrary = true;
+    return;
+  }
+  advanceAfterFinish(ev.at);
+}
+
+static void advanceAfterFinish(unsigned long finishedAt) {
+  playbackState = PlaybackState::Stopped; // nothing to fade out, the track ran out
+  uint16_t next;
+  if (!trackAfter(next)) return;
+  advancePending = true;
+  advanceFinishAt = finishedAt;
+  eotStats.advances++;
+  startTrack(next);
+}
+
+static void handlePlayFailed(const DfEvent &ev) {
+  advancePending = false;
+  playbackState = PlaybackState::Stopped; // the file never started
+  AudioBackend::cancelTimed();             // nor will its fade-in
+  if (ev.param == DfError::CardFailure) return;
+  // Busy: the decoder was still spinning up, ask again. Anything else means
+  // the file is unplayable; move past it unless the policy would loop on it.
+  bool retry = ev.param == DfError::Busy;
+  if (!libraryReady()) {
+    if (retry) {
+      playLocation(currentLoc);
+    } else {
+      advanceWhenLibrary = true;
+    }
+    return;
+  }
+  uint16_t next = currentTrack;
+  if (++failedPlays >= DFPLAYER_SKIP_LIMIT || (!retry && endPolicy == EndOfTrack::RepeatOne) ||
+      (!retry && !trackAfter(next))) {
+    failedPlays = 0;
+    return;
+  }
+  if (!retry) eotStats.skipped++;
+  startTrack(next);
+}
+
+static bool isReconcileQuery(uint8_t command) {
+  return command == DfCmd::QueryStatus || command == DfCmd::QueryVolume || command == DfCmd::QueryTfTrack;
+}
+
+static void startRound(bool full, unsigned long now) {
+  if (full) {
+    AudioBackend::send(DfCmd::QueryTfTrack);
+    AudioBackend::send(DfCmd::QueryStatus);
+    AudioBackend::send(DfCmd::QueryVolume);
+    reconcileStarted();
+  } else {
+    AudioBackend::send(DfCmd::QueryStatus);
+  }
+  roundReplies = full ? 3 : 1;
+  roundFull = full;
+  roundClean = true;
+  roundQueued = AudioBackend::stats().queued;
+  healthPingSent(now); // any of the replies shows the module is alive
+}
+
+// Each check returns false after it queued a correction.
+static bool checkStatus(uint16_t param, unsigned long at) {
+  uint8_t code = param & 0xFF;
+  if (code > 2) return true; // sleeping or an answer this firmware does not know
+  PlaybackState module = code == 1 ? PlaybackState::Playing
+                         : code == 2 ? PlaybackState::Paused
+                                     : PlaybackState::Stopped;
+  if (module == playbackState) return true;
+  if (playbackState == PlaybackState::Stopped && module == PlaybackState::Paused) return true; // both silent
+  reconcileMismatch(ReconcileField::Status);
+  switch (playbackState) {
+    case PlaybackState::Playing:
+      if (module == PlaybackState::Paused) {
+        AudioBackend::send(DfCmd::Resume);
+        fadeQueue(moduleVolume, currentVolume, AUDIO_FADE_IN_MS);
+        sentVolume = currentVolume;
+      } else if (moduleTrackKnown) {
+        // It was seen playing this file and stopped: the 0x3D went missing.
+        leaveTrack(true);
+        advanceAfterFinish(at);
+      } else {
+        playLocation(currentLoc); // the play never took
+      }
+      return false;
+    case PlaybackState::Paused:
+      if (module == PlaybackState::Playing) {
+        AudioBackend::send(DfCmd::Pause);
+        return false;
+      }
+      playbackState = PlaybackState::Stopped; // nothing left to resume
+      return true;
+    default:
+      AudioBackend::send(DfCmd::Stop); // playing while the model says it is not
+      return false;
+  }
+}
+
+static bool checkVolume(uint8_t level) {
+  bool heard = level == moduleVolume;
+  moduleVolume = level;
+  bool wrong = playbackState == PlaybackState::Playing && level != currentVolume;
+  if (heard && !wrong) return true;
+  reconcileMismatch(ReconcileField::Volume);
+  if (!wrong) return true;
+  sentVolume = currentVolume;
+  AudioBackend::send(DfCmd::SetVolume, currentVolume);
+  return false;
+}
+
+static bool checkTrack(uint16_t index) {
+  if (playbackState == PlaybackState::Stopped) return true;
+  if (!moduleTrackKnown && !(playMovedFile && trackBeforePlay != 0 && index == trackBeforePlay)) {
+    moduleTrack = index;
+    moduleTrackKnown = true;
+    return true;
+  }
+  if (moduleTrackKnown && index == moduleTrack) return true;
+  reconcileMismatch(ReconcileField::Track);
+  playLocation(currentLoc);
+  return false;
+}
+
+static void handleReconcileReply(const DfEvent &ev) {
+  if (roundReplies == 0 || !isReconcileQuery(ev.command)) return;
+  roundReplies--;
+  // Anything queued since, or a change still held back, and the replies no
+  // longer describe what the model holds.
+  if (AudioBackend::stats().queued != roundQueued || trackIntentPending || volumeIntentPending ||
+      AudioBackend::timedPending()) {
+    roundReplies = 0;
+    if (roundFull) reconcileVoided(ev.at);
+    return;
+  }
+  bool ok;
+  if (ev.command == DfCmd::QueryStatus) {
+    ok = checkStatus(ev.param, ev.at);
+  } else if (ev.command == DfCmd::QueryVolume) {
+    ok = checkVolume(static_cast<uint8_t>(ev.param));
+  } else {
+    ok = checkTrack(ev.param);
+  }
+  if (!ok) {
+    roundClean = false;
+    roundReplies = 0; // the rest would be voided by the correction anyway
+  }
+  if (roundReplies > 0) return;
+  if (roundFull) {
+    reconcileFinished(roundClean, ev.at);
+  } else if (!roundClean) {
+    reconcileSoon(ev.at); // a ping caught it; confirm with a full round
+  }
+}
+
+static void handlePlaybackEvent(const DfEvent &ev) {
+  switch (ev.type) {
+    case DfEventType::TrackFinished:
+      handleTrackFinished(ev);
+      break;
+    case DfEventType::Ack:
+      if (ev.command == DfCmd::SetVolume) moduleVolume = ev.param;
+      if (ev.command == DfCmd::Pause || ev.command == DfCmd::Resume || isPlayCommand(ev.command)) {
+        modulePaused = ev.command == DfCmd::Pause;
+      }
+      if (!isPlayCommand(ev.command)) break;
+      failedPlays = 0;
+      if (firstAudioAt == 0) firstAudioAt = ev.at;
+      if (advancePending) {
+        uint32_t latency = ev.at - advanceFinishAt;
+        advancePending = false;
+        eotStats.latencySamples++;
+        eotStats.latencyLastMs = latency;
+        eotStats.latencyTotalMs += latency;
+        if (latency > eotStats.latencyMaxMs) eotStats.latencyMaxMs = latency;
+      }
+      break;
+    case DfEventType::Reply:
+      handleReconcileReply(ev);
+      break;
+    case DfEventType::Error:
+      if (isPlayCommand(ev.command)) handlePlayFailed(ev);
+      if (isReconcileQuery(ev.command) && roundReplies > 0) {
+        roundReplies = 0;
+        if (roundFull) reconcileVoided(ev.at);
+      }
+      break;
+    case DfEventType::Timeout:
+      if (isPlayCommand(ev.command)) advancePending = false;
+      if (isReconcileQuery(ev.command) && roundReplies > 0) {
+        roundReplies = 0;
+        if (roundFull) reconcileVoided(ev.at);
+      }
+      break;
+    case DfEventType::CardRemoved:
+      advancePending = false;
+      if (playbackState == PlaybackState::Playing) playOnRecovery = true;
+      playbackState = PlaybackState::Stopped;
+      break;
+    case DfEventType::CardInserted:
+      relink();
+      break;
+    default:
+      break;
+  }
+}
+
+// Drop a held burst and put back what the module is still playing.
+static void endTrackBurst() {
+  trackIntentPending = false;
+  currentLoc = burstStart.loc;
+  playbackState = burstStart.state;
+  statsCounted = burstStart.statsCounted;
+  elapsedBeforeMs = burstStart.elapsedBeforeMs;
+  playingSince = burstStart.playingSince;
+}
+
+static void flushTrackIntent() {
+  endTrackBurst();
+  // A burst that ends where it started (Next then Prev) needs no command.
+  if (currentTrack == trackBeforeIntent && playbackState == PlaybackState::Playing) return;
+  coalesceStats.trackSends++;
+  audioPlayTrack(currentTrack);
+}
+
+static void flushIntents(unsigned long now) {
+  if (trackIntentPending && libraryReady() && now - trackIntentAt >= AUDIO_SKIP_COALESCE_MS) flushTrackIntent();
+  if (volumeIntentPending && volumeFree() && now - volumeSentAt >= AUDIO_VOLUME_COALESCE_MS) sendVolume(now);
+  if (eqIntentPending && linkState == LinkState::Ready && now - eqChangedAt >= AUDIO_SETTINGS_SETTLE_MS) sendEq();
+}
+
+static void requestTrack(uint16_t trackNumber) {
+  unsigned long now = millis();
+  coalesceStats.trackIntents++;
+  if (!trackIntentPending && now - lastPlayAt >= AUDIO_SKIP_COALESCE_MS) {
+    // A lone tap plays at once; only the taps that follow it are held.
+    coalesceStats.trackSends++;
+    audioPlayTrack(trackNumber);
+    return;
+  }
+  if (!trackIntentPending) {
+    trackBeforeIntent = playbackState == PlaybackState::Playing ? currentTrack : 0;
+    burstStart = {currentLoc, playbackState, statsCounted, elapsedBeforeMs, playingSince};
+  }
+  statsCounted = true; // tracks passed over in a burst never played
+  currentTrack = trackNumber;
+  currentLoc = libraryLocate(trackNumber);
+  playbackState = PlaybackState::Playing;
+  elapsedBeforeMs = 0;
+  playingSince = now;
+  trackIntentPending = true;
+  trackIntentAt = now;
+}
+
+static void requestVolume() {
+  coalesceStats.volumeIntents++;
   if (!initialized) return;
   unsigned long now = millis();
-  if (now - lastQuery > 1000) {
-    lastQuery = now;
-    // Reserved for periodic polling
+  if (!volumeIntentPending && volumeFree() && now - volumeSentAt >= AUDIO_VOLUME_COALESCE_MS) {
+    sendVolume(now); // first press of a burst goes out at once
+  } else {
+    volumeIntentPending = true;
   }
 }
 
-void audioPlayTrack(uint16_t trackNumber) {
-  currentTrack = constrain(trackNumber, (uint16_t)1, trackCount);
-  if (initialized) {
-    if (currentTrack <= trackCount) {
-      dfPlayer.playMp3Folder(currentTrack);
-      playbackState = PlaybackState::Playing;
+void audioInit() {
+  ResumeState rs;
+  if (resumeLoad(rs)) {
+    currentLoc = TrackLocation{rs.folder, rs.track};
+    currentVolume = rs.volume;
+    endPolicy = static_cast<EndOfTrack>(rs.endPolicy);
+    // The library is not loaded yet, so this only sets the flag.
+    ShuffleMode mode = rs.shuffleOn <= static_cast<uint8_t>(ShuffleMode::Smart)
+                           ? static_cast<ShuffleMode>(rs.shuffleOn)
+                           : ShuffleMode::Off;
+    playlistSetShuffle(mode, 0);
+    savedShuffle = rs.shuffle;
+    shuffleRestorePending = mode == ShuffleMode::Plain;
+  }
+  settingsBegin();
+  statsBegin();
+  if (settingsStartVolume() > 0) currentVolume = settingsStartVolume();
+  if (currentVolume > settingsVolumeCap()) currentVolume = settingsVolumeCap();
+  playlistBegin();
+  bootFromCache = libraryLoadCache();
+  AudioBackend::begin();
+  bootStartedAt = millis();
+  linkState = LinkState::Booting;
+}
+
+void audioLoop() {
+  unsigned long now = millis();
+  // Bring-up waits for the module itself, not NullBackend standing in for it.
+  bool standby = AudioBackend::inStandby();
+  if (linkState == LinkState::Booting && !standby && now - bootStartedAt >= DFPLAYER_BOOT_MS) {
+    if (libraryReady()) {
+      linkReady(libraryTotal());
+    } else {
+      probeCard();
+    }
+  }
+  if (linkState == LinkState::Absent && !standby && healthRetryDue(now)) probeCard();
+
+  AudioBackend::service(now);
+
+  DfEvent ev;
+  while (AudioBackend::pollEvent(ev)) {
+    if (ev.type == DfEventType::Timeout) {
+      healthTimedOut();
+    } else {
+      healthHeard(ev.at);
+    }
+    if (ev.type == DfEventType::InitDone && linkState == LinkState::Booting) {
+      bootStartedAt = now - DFPLAYER_BOOT_MS; // module reported in early, probe now
+      continue;
+    }
+    if (ev.type == DfEventType::InitDone && linkState == LinkState::Ready) {
+      relink(); // unprompted power-on report: the module browned out and rebooted
+      continue;
+    }
+    if (linkState == LinkState::Ready) {
+      bool consumed;
+      if (libraryHandleEvent(ev, consumed)) libraryLoaded();
+      if (!consumed) handlePlaybackEvent(ev);
+    } else {
+      handleLinkEvent(ev);
     }
   }
+
+  if (linkState == LinkState::Ready) {
+    if (healthLost()) {
+      linkAbsent(now);
+    } else if (AudioBackend::idle() && roundReplies == 0) {
+      // Only from a quiet link with nothing held back, so the replies
+      // describe a settled state, and not in standby: NullBackend only
+      // repeats what it was told.
+      bool settled = libraryReady() && !AudioBackend::timedPending() && !trackIntentPending && !volumeIntentPending &&
+                     !standby;
+      // A settled player is checked by the rounds themselves; a ping only
+      // follows up a query that went unanswered.
+      if (settled && reconcileDue(now)) {
+        startRound(true, now);
+      } else if (healthPingDue(now, settled ? reconcileIntervalMs() : DFPLAYER_PING_MS)) {
+        if (settled) {
+          startRound(false, now);
+        } else {
+          AudioBackend::send(DfCmd::QueryStatus);
+          healthPingSent(now);
+        }
+      }
+    }
+  }
+
+  flushIntents(now);
+  if (AudioBackend::idle()) statsLoop();
+  if (standbyWanted && !AudioBackend::inStandby() && audioQuiet()) {
+    AudioBackend::setStandby(true);
+    moduleTrackKnown = false; // NullBackend numbers files its own way
+    trackBeforePlay = 0;
+    playMovedFile = false;
+  }
+}
+
+void audioPlayTrack(uint16_t trackNumber) {
+  advancePending = false;
+  failedPlays = 0;
+  startTrack(trackNumber);
 }
 
 void audioNext() {
   if (!online || !initialized) return;
-  if (trackCount <= 1) return;
-  if (currentTrack < trackCount) {
-    currentTrack++;
-    audioPlayTrack(currentTrack);
+  if (!libraryReady()) {
+    stepsBeforeLibrary++;
+    return;
   }
+  // A skip wraps under repeat-all, and always while shuffling (into a fresh
+  // round); otherwise it stops at the end of the order.
+  uint16_t next;
+  if (playlistNext(endPolicy == EndOfTrack::RepeatAll || playlistShuffle(), next)) requestTrack(next);
 }
 
 void audioPrev() {
   if (!online || !initialized) return;
-  if (trackCount <= 1) return;
-  if (currentTrack > 1) {
-    currentTrack--;
-    audioPlayTrack(currentTrack);
+  if (!libraryReady()) {
+    stepsBeforeLibrary--;
+    return;
   }
+  uint16_t prev;
+  if (playlistPrev(prev)) requestTrack(prev);
+}
+
+void audioNextFolder() {
+  if (!online || !initialized || !libraryReady() || libraryFlat()) return;
+  uint16_t track = libraryFolderStep(currentTrack, 1);
+  playlistJump(track);
+  requestTrack(track);
+}
+
+bool audioJumpTo(uint16_t track) {
+  if (!online || !initialized || !libraryReady() || track == 0 || track > libraryTotal()) return false;
+  if (trackIntentPending) endTrackBurst(); // the jump replaces a pending skip
+  playlistJump(track);
+  audioPlayTrack(track);
+  return true;
+}
+
+static void pauseAfterFade(uint16_t fadeMs) {
+  uint16_t stepMs = 0;
+  if (fadeMs > 0) stepMs = fadeQueue(moduleVolume, 0, fadeMs, 1);
+  AudioBackend::sendAfter(DfCmd::Pause, 0, stepMs);
+  elapsedBeforeMs = audioElapsedMs();
+  playbackState = PlaybackState::Paused;
+  reconcileSoon(millis());
 }
 
 void audioTogglePause() {
   if (!initialized) return;
+  if (trackIntentPending) flushTrackIntent(); // pause applies to the track the user landed on
+  AudioBackend::cancelTimed();
   if (playbackState == PlaybackState::Playing) {
-    dfPlayer.pause();
-    playbackState = PlaybackState::Paused;
+    pauseAfterFade(AUDIO_FADE_OUT_MS);
   } else {
-    dfPlayer.start();
+    if (playbackState == PlaybackState::Stopped) {
+      if (libraryReady()) {
+        audioPlayTrack(currentTrack); // nothing left to resume once the track ended
+      } else {
+        playLocation(currentLoc);
+      }
+      return;
+    }
+    // Mute before resuming if the pause left the module audible; a fade-out
+    // cut short before its Pause went out just turns around instead.
+    uint8_t level = moduleVolume;
+    if (AUDIO_FADE_IN_MS > 0 && modulePaused && level != 0) {
+      fadeQueue(level, 0, 0);
+      level = 0;
+    }
+    AudioBackend::sendAfter(DfCmd::Resume, 0, 0);
+    fadeQueue(level, currentVolume, AUDIO_FADE_IN_MS);
+    sentVolume = currentVolume;
+    playingSince = millis();
     playbackState = PlaybackState::Playing;
+    reconcileSoon(playingSince);
+  }
+}
+
+bool audioFadeToPause(uint16_t fadeMs) {
+  if (!initialized) return false;
+  if (trackIntentPending) flushTrackIntent();
+  if (playbackState != PlaybackState::Playing) return false;
+  AudioBackend::cancelTimed();
+  pauseAfterFade(fadeMs);
+  return true;
+}
+
+void audioSetStandby(bool on) {
+  if (on == standbyWanted) return;
+  standbyWanted = on;
+  if (on) {
+    standbyResume = audioFadeToPause(AUDIO_FADE_OUT_MS);
+    return;
   }
+  if (!AudioBackend::inStandby()) {
+    if (standbyResume) audioTogglePause(); // the fade had not finished; turn it around
+    return;
+  }
+  AudioBackend::setStandby(false);
+  if (linkState == LinkState::Booting) return; // bring-up has not started yet
+  relink();
+  playOnRecovery = playOnRecovery || standbyResume;
+}
+
+bool audioStandby() {
+  return standbyWanted;
+}
+
+bool audioQuiet() {
+  return !AudioBackend::timedPending() && AudioBackend::idle();
 }
 
 bool audioVolumeUp() {
-  if (currentVolume < MAX_VOLUME) {
+  if (currentVolume < settingsVolumeCap()) {
     currentVolume++;
-    if (initialized) {
-      dfPlayer.volume(currentVolume);
-    }
+    requestVolume();
     return true;
   }
   return false;
@@ -103,21 +902,162 @@ bool audioVolumeUp() {
 bool audioVolumeDown() {
   if (currentVolume > MIN_VOLUME) {
     currentVolume--;
-    if (initialized) {
-      dfPlayer.volume(currentVolume);
-    }
+    requestVolume();
     return true;
   }
   return false;
 }
 
+void audioSetEndOfTrack(EndOfTrack policy) {
+  endPolicy = policy;
+}
+
+EndOfTrack audioEndOfTrack() {
+  return endPolicy;
+}
+
+void audioSetShuffle(ShuffleMode mode) {
+  // Starts the order from the track that is playing now.
+  playlistSetShuffle(mode, currentTrack);
+}
+
+void audioSettingsChanged() {
+  coalesceStats.eqIntents++;
+  if (currentVolume > settingsVolumeCap()) {
+    currentVolume = settingsVolumeCap();
+    requestVolume();
+  }
+  eqIntentPending = true;
+  eqChangedAt = millis();
+}
+
+bool audioPlayStats(bool favorites) {
+  if (!initialized || !libraryReady()) return false;
+  static TrackLocation picked[PLAYLIST_CAPACITY];
+  uint16_t count = favorites ? statsFavorites(picked, PLAYLIST_CAPACITY) : statsMostPlayed(picked, PLAYLIST_CAPACITY);
+  if (count == 0) return false;
+  playlistClear();
+  for (uint16_t i = 0; i < count; ++i) {
+    uint16_t track = libraryTrackOf(picked[i]); // 0: the file is not on this card
+    if (track != 0) playlistAppend(track);
+  }
+  return audioPlaylistPlay(-1);
+}
+
+bool audioToggleFavorite() {
+  if (!initialized) return false;
+  return statsToggleFavorite(currentLoc);
+}
+
+bool audioPlaylistPlay(int8_t slot) {
+  if (!initialized || !libraryReady()) return false;
+  if (slot >= 0 && !playlistLoad(slot)) return false;
+  uint16_t first;
+  if (!playlistStart(first)) return false;
+  if (trackIntentPending) endTrackBurst(); // the list replaces a pending skip
+  audioPlayTrack(first);
+  return true;
+}
+
+uint32_t audioElapsedMs() {
+  if (playbackState != PlaybackState::Playing) return elapsedBeforeMs;
+  return elapsedBeforeMs + (millis() - playingSince);
+}
+
+void audioSnapshot(ResumeState &out) {
+  out.folder = currentLoc.folder;
+  out.track = currentLoc.file;
+  out.volume = currentVolume;
+  out.endPolicy = static_cast<uint8_t>(endPolicy);
+  out.shuffleOn = static_cast<uint8_t>(playlistShuffleMode());
+  if (shuffleRestorePending) {
+    out.shuffle = savedShuffle; // link not up yet, keep what was loaded
+  } else {
+    out.shuffle = playlistShuffleState();
+  }
+  out.elapsedMs = audioElapsedMs();
+}
+
 AudioStatus getAudioStatus() {
   AudioStatus s{};
   s.track = currentTrack;
   s.volume = currentVolume;
   s.trackCount = trackCount;
+  s.folder = currentLoc.folder;
+  s.file = currentLoc.file;
   s.online = online;
+  s.shuffle = playlistShuffleMode();
   s.state = playbackState;
+  s.favorite = statsFavorite(currentLoc);
   return s;
 }
 
+void audioPrintStats(Print &out) {
+  const DfStats &st = AudioBackend::stats();
+  out.print("df queued=");
+  out.print(st.queued);
+  out.print(" sent=");
+  out.print(st.sent);
+  out.print(" dropped=");
+  out.print(st.dropped);
+  out.print(" acks=");
+  out.print(st.acks);
+  out.print(" timeouts=");
+  out.print(st.timeouts);
+  out.print(" rx=");
+  out.print(st.rxFrames);
+  out.print(" rxErr=");
+  out.println(st.rxErrors);
+
+  out.print("boot firstAudio=");
+  out.print(firstAudioAt);
+  out.println(bootFromCache ? "ms (cached library)" : "ms (scanned library)");
+
+  healthPrintStats(out, millis());
+  reconcilePrintStats(out);
+  fadePrintStats(out);
+  libraryPrintStats(out);
+
+  out.print("coalesce track ");
+  out.print(coalesceStats.trackIntents);
+  out.print("->");
+  out.print(coalesceStats.trackSends);
+  out.print(" volume ");
+  out.print(coalesceStats.volumeIntents);
+  out.print("->");
+  out.print(coalesceStats.volumeSends);
+  out.print(" eq ");
+  out.print(coalesceStats.eqIntents);
+  out.print("->");
+  out.println(coalesceStats.eqSends);
+  settingsPrintStats(out);
+  statsPrintStats(out);
+
+  playlistPrintStats(out);
+  if (playlistShuffleMode() == ShuffleMode::Plain) {
+    ShuffleState sh = playlistShuffleState();
+    out.print("shuffle seed=");
+    out.print(sh.seed, 16);
+    out.print(" pos=");
+    out.println(sh.cursor + 1);
+  }
+
+  static const char *const POLICY_NAMES[] = {"stop", "continue", "repeat-all", "repeat-one"};
+  out.print("eot policy=");
+  out.print(POLICY_NAMES[static_cast<uint8_t>(endPolicy)]);
+  out.print(" finished=");
+  out.print(eotStats.finished);
+  out.print(" ignored=");
+  out.print(eotStats.ignored);
+  out.print(" advances=");
+  out.print(eotStats.advances);
+  out.print(" skipped=");
+  out.print(eotStats.skipped);
+  out.print(" latency last=");
+  out.print(eotStats.latencyLastMs);
+  out.print("ms avg=");
+  out.print(eotStats.latencySamples ? eotStats.latencyTotalMs / eotStats.latencySamples : 0);
+  out.print("ms max=");
+  out.print(eotStats.latencyMaxMs);
+  out.println("ms");
+}
@@ -2,6 +2,8 @@
 
 #include <Arduino.h>
 #include "config.h"
+#include "playlist.h"
+#include "resume.h"
 
 enum class PlaybackState {
   Stopped,
@@ -10,10 +12,14 @@ enum class PlaybackState {
 };
 
 struct AudioStatus {
-  uint16_t track;
+  uint16_t track;      // 1..trackCount across the whole library
+  uint8_t folder;      // file the track resolves to; folder 0 = /mp3
+  uint16_t file;
   uint8_t volume;
   uint16_t trackCount;
   bool online;
+  ShuffleMode shuffle;
+  bool favorite;
   PlaybackState state;
 };
 
@@ -22,8 +28,35 @@ void audioLoop();
 void audioPlayTrack(uint16_t trackNumber);
 void audioNext();
 void audioPrev();
+void audioNextFolder();
+// Plays library track `track` at once and continues in library order from it.
+bool audioJumpTo(uint16_t track);
 void audioTogglePause();
+// Fades out over `fadeMs` and pauses; false if nothing was playing. A later
+// audioTogglePause() resumes the same track, turning the fade around if it
+// has not finished.
+bool audioFadeToPause(uint16_t fadeMs);
+// Nothing queued or in flight on the DFPlayer link (fades included).
+bool audioQuiet();
+// BT mode: pause and leave the module alone; on return bring it up again and
+// restart the track if it was playing.
+void audioSetStandby(bool on);
+bool audioStandby();
 bool audioVolumeUp();
 bool audioVolumeDown();
+void audioSetEndOfTrack(EndOfTrack policy);
+EndOfTrack audioEndOfTrack();
+void audioSetShuffle(ShuffleMode mode);
+// Applies settingsGet(): the output's volume limit at once, the EQ once edits settle.
+void audioSettingsChanged();
+// Plays the working list (slot < 0) or loads saved slot `slot` and plays it.
+bool audioPlaylistPlay(int8_t slot);
+// Replaces the working list with the favourites (or the most played tracks)
+// on this card and plays it.
+bool audioPlayStats(bool favorites);
+bool audioToggleFavorite(); // for the file playing now; returns the new state
+uint32_t audioElapsedMs();
+void audioSnapshot(ResumeState &out); // fills everything but uiMode
 AudioStatus getAudioStatus();
+void audioPrintStats(Print &out);
 
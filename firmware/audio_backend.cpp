@@ -0,0 +1,83 @@
+#include "audio_backend.h"
+
+static const uint8_t NULL_EVENT_QUEUE_LEN = 32; // a fade, a play and its fade-in, acked at once
+
+static DfEvent events[NULL_EVENT_QUEUE_LEN];
+static uint8_t eventHead = 0;
+static uint8_t eventCount = 0;
+static uint8_t status = 0; // as 0x42 reports it: 0 stopped, 1 playing, 2 paused
+static uint8_t volume = 0;
+static uint16_t playing = 0; // stands in for the 0x4C file index
+static DfStats linkStats{};
+
+static void pushEvent(DfEventType type, uint8_t command, uint16_t param) {
+  if (eventCount == NULL_EVENT_QUEUE_LEN) {
+    linkStats.dropped++;
+    return;
+  }
+  DfEvent &ev = events[(eventHead + eventCount) % NULL_EVENT_QUEUE_LEN];
+  ev.type = type;
+  ev.command = command;
+  ev.param = param;
+  ev.at = millis();
+  eventCount++;
+}
+
+void NullBackend::begin() {
+  eventHead = eventCount = 0;
+}
+
+bool NullBackend::send(uint8_t command, uint16_t param) {
+  linkStats.queued++;
+  linkStats.sent++;
+  switch (command) {
+    case DfCmd::QueryStatus:
+      pushEvent(DfEventType::Reply, command, 0x0200 | status);
+      return true;
+    case DfCmd::QueryVolume:
+      pushEvent(DfEventType::Reply, command, volume);
+      return true;
+    case DfCmd::QueryTfTrack:
+      pushEvent(DfEventType::Reply, command, playing);
+      return true;
+    case DfCmd::PlayFolder:
+    case DfCmd::PlayMp3Folder:
+      status = 1;
+      playing = param;
+      break;
+    case DfCmd::Pause:
+      if (status == 1) status = 2;
+      break;
+    case DfCmd::Resume:
+      if (status == 2) status = 1;
+      break;
+    case DfCmd::Stop:
+      status = 0;
+      break;
+    case DfCmd::SetVolume:
+      volume = static_cast<uint8_t>(param);
+      break;
+    default:
+      if (dfIsQuery(command)) {
+        linkStats.timeouts++;
+        pushEvent(DfEventType::Timeout, command, 0);
+        return true;
+      }
+      break;
+  }
+  linkStats.acks++;
+  pushEvent(DfEventType::Ack, command, param);
+  return true;
+}
+
+bool NullBackend::pollEvent(DfEvent &ev) {
+  if (eventCount == 0) return false;
+  ev = events[eventHead];
+  eventHead = (eventHead + 1) % NULL_EVENT_QUEUE_LEN;
+  eventCount--;
+  return true;
+}
+
+const DfStats &NullBackend::stats() {
+  return linkStats;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "dfplayer.h"
+
+// Where the playback engine (audio.cpp, and the fade and library scan it
+// drives) sends DFPlayer commands and gets events from. A backend is a type
+// with these static members, the same contract as dfplayer.h:
+//
+//   static void begin();
+//   static bool send(uint8_t command, uint16_t param = 0);
+//   static bool sendAfter(uint8_t command, uint16_t param, uint16_t afterMs);
+//   static uint8_t cancelTimed();
+//   static bool timedPending();
+//   static uint8_t queueFree();
+//   static uint16_t ackLatencyMs();
+//   static void service(unsigned long now);
+//   static bool pollEvent(DfEvent &ev);
+//   static bool idle();
+//   static void flush();
+//   static const DfStats &stats();
+//
+// The engine is compiled against one type, AudioBackend below, so every call
+// resolves at compile time and inlines; there is no vtable. The commands and
+// events stay the DFPlayer's own codes (DfCmd, DfEventType): the engine's
+// fades, library scan and reconciliation are written in them.
+//
+// AudioBackend puts the live backend behind StandbyBackend, which hands the
+// engine NullBackend instead while the module must be left alone (BT mode).
+
+// The module on UART1, through dfplayer.cpp.
+struct DfPlayerBackend {
+  static void begin() { dfBegin(); }
+  static bool send(uint8_t command, uint16_t param = 0) { return dfSend(command, param); }
+  static bool sendAfter(uint8_t command, uint16_t param, uint16_t afterMs) {
+    return dfSendAfter(command, param, afterMs);
+  }
+  static uint8_t cancelTimed() { return dfCancelTimed(); }
+  static bool timedPending() { return dfTimedPending(); }
+  static uint8_t queueFree() { return dfQueueFree(); }
+  static uint16_t ackLatencyMs() { return dfAckLatencyMs(); }
+  static void service(unsigned long now) { dfService(now); }
+  static bool pollEvent(DfEvent &ev) { return dfPollEvent(ev); }
+  static bool idle() { return dfIdle(); }
+  static void flush() { dfFlushQueue(); }
+  static const DfStats &stats() { return dfStats(); }
+};
+
+// No module: commands are acked at once and timed ones do not wait. 0x42,
+// 0x43 and 0x4C are answered from what it was told, so health pings and
+// reconciliation see a module that does as asked; it never finishes a track.
+// Any other query times out, so a bring-up or library scan through it never
+// gets a card to trust.
+struct NullBackend {
+  static void begin();
+  static bool send(uint8_t command, uint16_t param = 0);
+  static bool sendAfter(uint8_t command, uint16_t param, uint16_t afterMs) {
+    (void)afterMs;
+    return send(command, param);
+  }
+  static uint8_t cancelTimed() { return 0; }
+  static bool timedPending() { return false; }
+  static uint8_t queueFree() { return DFPLAYER_QUEUE_LEN; } // nothing waits
+  static uint16_t ackLatencyMs() { return 0; }
+  static void service(unsigned long now) { (void)now; }
+  static bool pollEvent(DfEvent &ev);
+  static bool idle() { return true; }
+  static void flush() {}
+  static const DfStats &stats();
+};
+
+// Live until setStandby(true), Standby after that. Both keep being serviced,
+// but what Live reports while in standby is dropped: the engine runs bring-up
+// again when it leaves standby rather than trust it.
+template <typename Live, typename Standby>
+struct StandbyBackend {
+  static void setStandby(bool on) {
+    if (on && !standbyOn) Standby::begin();
+    standbyOn = on;
+  }
+  static bool inStandby() { return standbyOn; }
+
+  static void begin() { Live::begin(); }
+  static bool send(uint8_t command, uint16_t param = 0) {
+    return standbyOn ? Standby::send(command, param) : Live::send(command, param);
+  }
+  static bool sendAfter(uint8_t command, uint16_t param, uint16_t afterMs) {
+    return standbyOn ? Standby::sendAfter(command, param, afterMs) : Live::sendAfter(command, param, afterMs);
+  }
+  static uint8_t cancelTimed() { return standbyOn ? Standby::cancelTimed() : Live::cancelTimed(); }
+  static bool timedPending() { return standbyOn ? Standby::timedPending() : Live::timedPending(); }
+  static uint8_t queueFree() { return standbyOn ? Standby::queueFree() : Live::queueFree(); }
+  static uint16_t ackLatencyMs() { return standbyOn ? Standby::ackLatencyMs() : Live::ackLatencyMs(); }
+  static void service(unsigned long now) {
+    Live::service(now);
+    if (standbyOn) Standby::service(now);
+  }
+  static bool pollEvent(DfEvent &ev) {
+    if (!standbyOn) return Live::pollEvent(ev);
+    while (Live::pollEvent(ev)) {
+    }
+    return Standby::pollEvent(ev);
+  }
+  static bool idle() { return standbyOn ? Standby::idle() : Live::idle(); }
+  static void flush() { standbyOn ? Standby::flush() : Live::flush(); }
+  static const DfStats &stats() { return standbyOn ? Standby::stats() : Live::stats(); }
+
+ private:
+  static bool standbyOn;
+};
+
+template <typename Live, typename Standby>
+bool StandbyBackend<Live, Standby>::standbyOn = false;
+
+// Chosen at build time. The firmware drives the module; -DAUDIO_BACKEND_NULL
+// builds for a board without one, and host builds pass -DAUDIO_BACKEND_SIM
+// with tools/host on the include path for its timed module model.
+#if defined(AUDIO_BACKEND_SIM)
+#include "sim_backend.h"
+using LiveBackend = SimBackend;
+#elif defined(AUDIO_BACKEND_NULL)
+using LiveBackend = NullBackend;
+#else
+using LiveBackend = DfPlayerBackend;
+#endif
+using AudioBackend = StandbyBackend<LiveBackend, NullBackend>;
@@ -29,6 +29,72 @@ static const uint8_t MIN_VOLUME = 0;
 static const uint8_t MAX_VOLUME = 30;
 static const uint8_t DEFAULT_VOLUME = 20;
 
+// What happens when a track ends on its own
+enum class EndOfTrack : uint8_t {
+  Stop,      // stay on the finished track
+  Continue,  // next track, stop after the last one
+  RepeatAll, // next track, wrap to the first
+  RepeatOne  // same track again
+};
+static const EndOfTrack DEFAULT_END_OF_TRACK = EndOfTrack::Continue;
+static const uint16_t AUDIO_SKIP_COALESCE_MS = 200;  // play the last of a Next/Prev burst once taps stop
+static const uint16_t AUDIO_VOLUME_COALESCE_MS = 120; // at most one volume frame per window while held
+
+// Volume fades around pause, resume and track changes (0 = cut, no fade).
+// Ramps are queued as timed DFPlayer commands; the step spacing follows the
+// measured ack latency, so a slower link gets fewer, larger steps over the
+// same duration. AUDIO_FADE_CURVE is the fraction (percent) of the way to the
+// target at evenly spaced points of a fade-in; fade-outs mirror it. The
+// module's volume steps are already roughly logarithmic, so the curve only
+// hurries through the quietest steps.
+static const uint16_t AUDIO_FADE_IN_MS = 300;
+static const uint16_t AUDIO_FADE_OUT_MS = 180;
+static const uint16_t AUDIO_FADE_STEP_MIN_MS = 30;
+static const uint8_t AUDIO_FADE_CURVE[] = {0, 30, 50, 65, 77, 87, 94, 100};
+static const uint8_t AUDIO_FADE_CURVE_POINTS = sizeof(AUDIO_FADE_CURVE) / sizeof(AUDIO_FADE_CURVE[0]);
+
+// EQ and output profile (settings.h), edited from the on-screen selector
+static const uint8_t SETTINGS_HEADPHONE_MAX_VOLUME = 18; // default limit with headphones
+static const uint16_t AUDIO_SETTINGS_SETTLE_MS = 400;    // send the EQ once the selector stops moving
+
+// Playlists
+static const uint8_t PLAYLIST_CAPACITY = 64;  // tracks in the working list
+static const uint8_t PLAYLIST_QUEUE_LEN = 16; // "play next" / queued tracks
+static const uint8_t PLAYLIST_SLOTS = 4;      // saved lists in NVS
+
+// Smart shuffle (smartshuffle.h): weighted by play/skip history
+static const uint16_t SMART_SHUFFLE_MAX_TRACKS = 4096; // larger libraries fall back to plain shuffle
+static const uint8_t SMART_SHUFFLE_RECENT = 32;        // last tracks drawn, kept out of the draw
+
+// Sleep timer (sleeptimer.h): set from the settings selector or Serial `sleep N`
+static const uint8_t SLEEP_TIMER_STEP_MIN = 15;
+static const uint8_t SLEEP_TIMER_MAX_MIN = 120;
+static const uint16_t SLEEP_FADE_MS = 20000; // volume ramp to silence before the pause
+
+// Play statistics and favourites (trackstats.h)
+static const uint16_t STATS_MAX_TRACKS = 2048;  // tracks tracked in RAM
+static const uint32_t STATS_PLAY_MS = 30000;    // leaving a track later than this counts as a play, earlier as a skip
+static const uint8_t STATS_COMPACT_BELOW = 4;   // free flash sectors kept ahead of the log head
+
+// Resume state (NVS)
+static const uint16_t RESUME_SETTLE_MS = 5000;      // write once settings stop changing this long
+static const uint32_t RESUME_CHECKPOINT_MS = 60000; // elapsed-time save interval while playing
+
+// DFPlayer link
+static const uint32_t DFPLAYER_BAUD = 9600;
+static const uint16_t DFPLAYER_CMD_GAP_MS = 20;      // min spacing between frames
+static const uint16_t DFPLAYER_ACK_TIMEOUT_MS = 200; // ack/reply wait before giving up
+static const uint16_t DFPLAYER_BOOT_MS = 1500;       // probe after this if no power-on report
+static const uint8_t DFPLAYER_QUEUE_LEN = 16;
+static const uint16_t DFPLAYER_FINISH_DEDUPE_MS = 500; // module reports 0x3D twice
+static const uint8_t DFPLAYER_SKIP_LIMIT = 3;          // unplayable tracks in a row before stopping
+static const uint16_t DFPLAYER_PING_MS = 5000;         // status query after this much silence while unsettled
+static const uint8_t DFPLAYER_OFFLINE_TIMEOUTS = 3;    // unanswered requests in a row -> offline
+static const uint32_t DFPLAYER_RETRY_MIN_MS = 1000;    // first re-init attempt after going offline
+static const uint32_t DFPLAYER_RETRY_MAX_MS = 60000;   // backoff ceiling
+static const uint32_t RECONCILE_MIN_MS = 3000;         // state check after a playback command
+static const uint32_t RECONCILE_MAX_MS = 120000;       // doubles per matching check up to this
+
 // Debounce timings (milliseconds)
 static const uint16_t DEBOUNCE_MS = 50;
 static const uint16_t HOLD_MS = 120;
@@ -36,6 +102,9 @@ static const uint16_t REPEAT_MS_SLOW = 100;
 static const uint16_t REPEAT_MS_FAST = 50;
 static const uint16_t REPEAT_ACCEL_MS = 1000;
 static const uint16_t MODE_TOGGLE_HOLD_MS = 2000;
+static const uint16_t TOUCH_HOLD_MS = 800;     // touch released after this counts as a hold
+static const uint16_t SETTINGS_HOLD_MS = 2000; // Play released after this opens the settings selector
+static const uint16_t LATENCY_TRACE_WINDOW_MS = 1000; // input latency trace length (latency.h)
 
 // Battery measurement
 static const float ADC_REFERENCE = 3.3f;
@@ -51,13 +120,58 @@ static const uint8_t MANUAL_TIME_START_MIN = 50;  // set to your local minute
 // UI timing
 static const uint16_t UI_ANIM_MS = 350;
 static const uint16_t UI_VOLUME_OVERLAY_MS = 900;
+static const uint16_t UI_SETTINGS_IDLE_MS = 6000; // settings selector closes itself after this
+static const uint16_t UI_DIAL_IDLE_MS = 8000;     // track dial cancels itself after this
 static const uint16_t UI_SCANLINE_SPACING = 6;
+static const bool UI_FX_SCANLINES = true; // boot default, toggled with `fx scan`
 static const uint16_t UI_HUD_REFRESH_MS = 100;
 static const uint16_t UI_BATTERY_REFRESH_MS = 2000;
 static const uint32_t UI_BACKGROUND_REFRESH_MS = 60000;
 
+// Frame governor. Tiers are checked top to bottom; the first whose battery
+// floor is met applies. After UI_IDLE_AFTER_MS without input the governor
+// drops one more tier. A step of 0 disables that animation.
+struct FrameTier {
+  const char *name;
+  uint8_t minPercent;
+  uint16_t vinylStepMs;
+  uint16_t btAnimMs;
+  uint16_t hudRefreshMs;
+  bool eqBars;
+};
+
+static const FrameTier FRAME_TIERS[] = {
+  {"FULL", 60, 90, 120, UI_HUD_REFRESH_MS, true},
+  {"BALANCED", 30, 180, 240, 200, true},
+  {"SAVER", 15, 360, 480, 400, false},
+  {"CRITICAL", 0, 0, 0, 1000, false},
+};
+static const uint8_t FRAME_TIER_COUNT = sizeof(FRAME_TIERS) / sizeof(FRAME_TIERS[0]);
+static const uint32_t UI_IDLE_AFTER_MS = 30000;
+
+// Panel power: 8-colour idle mode, then sleep-in, after this long without input (0 = never)
+static const uint32_t UI_PANEL_IDLE_MS = 45000;
+static const uint32_t UI_PANEL_SLEEP_MS = 120000;
+static const uint16_t UI_PANEL_WAKE_SETTLE_MS = 5; // SLPOUT -> first pixel write
+
+// Mode transitions: the new mode's skin is revealed progressively, pushing at
+// most UI_TRANSITION_LINES_PER_FRAME lines (240 px each) per uiUpdate().
+enum class UITransition : uint8_t {
+  Cut,   // whole skin in one frame
+  Wipe,  // rows, top to bottom
+  Iris,  // circle opening from the centre
+  Slide  // columns, left to right
+};
+static const UITransition UI_TRANSITION_TO_BT = UITransition::Iris;
+static const UITransition UI_TRANSITION_TO_DFP = UITransition::Slide;
+static const uint16_t UI_TRANSITION_LINES_PER_FRAME = 16;
+
+// UI memory
+static const size_t UI_ARENA_BYTES = 12288; // save-under buffers for overlays
+
 // UI thresholds
 static const uint8_t UI_WARNING_THRESHOLD = 15; // battery percent
+static const uint8_t UI_WARNING_CLEAR_MARGIN = 3; // warning stays on until this far above the threshold
 
 // Colors
 static const uint16_t COLOR_BG = 0x0000; // Black
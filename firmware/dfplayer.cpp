@@ -0,0 +1,205 @@
+#include "dfplayer.h"
+
+#include "latency.h"
+
+static const uint8_t EVENT_QUEUE_LEN = 8;
+
+struct PendingCommand {
+  uint8_t command;
+  bool timed;       // withdrawn by dfCancelTimed()
+  uint16_t param;
+  uint16_t afterMs; // min spacing from the frame before it
+};
+
+static HardwareSerial dfSerial(1);
+static PendingCommand txQueue[DFPLAYER_QUEUE_LEN];
+static uint8_t txHead = 0;
+static uint8_t txCount = 0;
+static DfEvent eventQueue[EVENT_QUEUE_LEN];
+static uint8_t eventHead = 0;
+static uint8_t eventCount = 0;
+
+static bool inFlight = false;
+static uint8_t inFlightCommand = 0;
+static uint16_t inFlightParam = 0;
+static unsigned long inFlightSentAt = 0;
+static unsigned long lastTxAt = 0;
+static uint8_t timedCount = 0;
+static uint16_t ackLatencyX8 = 0; // write -> ack, smoothed over ~8 samples
+
+static DfFrameParser rxParser;
+static DfStats stats{};
+
+static void pushEvent(DfEventType type, uint8_t command, uint16_t param, unsigned long now) {
+  if (eventCount == EVENT_QUEUE_LEN) {
+    // Keep the newest: drop the oldest unread event.
+    eventHead = (eventHead + 1) % EVENT_QUEUE_LEN;
+    eventCount--;
+  }
+  DfEvent &ev = eventQueue[(eventHead + eventCount) % EVENT_QUEUE_LEN];
+  ev.type = type;
+  ev.command = command;
+  ev.param = param;
+  ev.at = now;
+  eventCount++;
+}
+
+static void handleFrame(const DfFrame &frame, unsigned long now) {
+  uint8_t command = frame.command;
+  uint16_t param = frame.param;
+
+  switch (command) {
+    case DfMsg::Ack:
+      stats.acks++;
+      if (inFlight && !dfIsQuery(inFlightCommand)) {
+        uint16_t sample = min<unsigned long>(now - inFlightSentAt, DFPLAYER_ACK_TIMEOUT_MS);
+        ackLatencyX8 = ackLatencyX8 == 0 ? sample * 8 : ackLatencyX8 - ackLatencyX8 / 8 + sample;
+        inFlight = false;
+        latencyFrameAcked(inFlightCommand, micros());
+        pushEvent(DfEventType::Ack, inFlightCommand, inFlightParam, now);
+      }
+      break;
+    case DfMsg::Error:
+      pushEvent(DfEventType::Error, inFlight ? inFlightCommand : 0, param, now);
+      inFlight = false;
+      break;
+    case DfMsg::TfFinished:
+    case DfMsg::UsbFinished:
+      pushEvent(DfEventType::TrackFinished, command, param, now);
+      break;
+    case DfMsg::CardInserted:
+      pushEvent(DfEventType::CardInserted, command, param, now);
+      break;
+    case DfMsg::CardRemoved:
+      pushEvent(DfEventType::CardRemoved, command, param, now);
+      break;
+    case DfMsg::InitDone:
+      pushEvent(DfEventType::InitDone, command, param, now);
+      break;
+    default:
+      if (dfIsQuery(command)) {
+        if (inFlight && inFlightCommand == command) inFlight = false;
+        pushEvent(DfEventType::Reply, command, param, now);
+      }
+      break;
+  }
+}
+
+void dfBegin() {
+  dfSerial.begin(DFPLAYER_BAUD, SERIAL_8N1, PIN_DFPLAYER_TX, PIN_DFPLAYER_RX);
+  txHead = txCount = 0;
+  timedCount = 0;
+  eventHead = eventCount = 0;
+  inFlight = false;
+  rxParser.reset();
+}
+
+static bool enqueue(uint8_t command, uint16_t param, uint16_t afterMs, bool timed) {
+  if (txCount == DFPLAYER_QUEUE_LEN) {
+    stats.dropped++;
+    return false;
+  }
+  PendingCommand &slot = txQueue[(txHead + txCount) % DFPLAYER_QUEUE_LEN];
+  slot.command = command;
+  slot.timed = timed;
+  slot.param = param;
+  slot.afterMs = afterMs;
+  txCount++;
+  if (timed) timedCount++;
+  stats.queued++;
+  return true;
+}
+
+bool dfSend(uint8_t command, uint16_t param) {
+  return enqueue(command, param, 0, false);
+}
+
+bool dfSendAfter(uint8_t command, uint16_t param, uint16_t afterMs) {
+  return enqueue(command, param, afterMs, true);
+}
+
+uint8_t dfCancelTimed() {
+  if (timedCount == 0) return 0;
+  // Compact the ring in place, keeping the order of what stays.
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < txCount; ++i) {
+    const PendingCommand &c = txQueue[(txHead + i) % DFPLAYER_QUEUE_LEN];
+    if (!c.timed) txQueue[(txHead + kept++) % DFPLAYER_QUEUE_LEN] = c;
+  }
+  uint8_t removed = txCount - kept;
+  txCount = kept;
+  timedCount = 0;
+  stats.cancelled += removed;
+  return removed;
+}
+
+bool dfTimedPending() {
+  return timedCount > 0;
+}
+
+uint8_t dfQueueFree() {
+  return DFPLAYER_QUEUE_LEN - txCount;
+}
+
+uint16_t dfAckLatencyMs() {
+  return ackLatencyX8 / 8;
+}
+
+void dfService(unsigned long now) {
+  while (dfSerial.available() > 0) {
+    if (rxParser.push(static_cast<uint8_t>(dfSerial.read()))) {
+      stats.rxFrames++;
+      handleFrame(rxParser.frame(), now);
+    }
+  }
+
+  if (inFlight && now - inFlightSentAt > DFPLAYER_ACK_TIMEOUT_MS) {
+    inFlight = false;
+    stats.timeouts++;
+    pushEvent(DfEventType::Timeout, inFlightCommand, 0, now);
+  }
+
+  if (inFlight || txCount == 0) return;
+  const PendingCommand &head = txQueue[txHead];
+  if (now - lastTxAt < max<uint16_t>(DFPLAYER_CMD_GAP_MS, head.afterMs)) return;
+  if (dfSerial.availableForWrite() < DF_FRAME_LEN) return;
+
+  PendingCommand next = head;
+  txHead = (txHead + 1) % DFPLAYER_QUEUE_LEN;
+  txCount--;
+  if (next.timed) timedCount--;
+
+  // Queries are confirmed by their reply, everything else asks for an ack.
+  uint8_t frame[DF_FRAME_LEN];
+  dfFrameEncode(frame, next.command, next.param, !dfIsQuery(next.command));
+  latencyFrameSent(next.command, micros());
+  dfSerial.write(frame, DF_FRAME_LEN);
+  inFlight = true;
+  inFlightCommand = next.command;
+  inFlightParam = next.param;
+  inFlightSentAt = now;
+  lastTxAt = now;
+  stats.sent++;
+}
+
+bool dfPollEvent(DfEvent &ev) {
+  if (eventCount == 0) return false;
+  ev = eventQueue[eventHead];
+  eventHead = (eventHead + 1) % EVENT_QUEUE_LEN;
+  eventCount--;
+  return true;
+}
+
+bool dfIdle() {
+  return !inFlight && txCount == 0;
+}
+
+void dfFlushQueue() {
+  txHead = txCount = 0;
+  timedCount = 0;
+}
+
+const DfStats &dfStats() {
+  stats.rxErrors = rxParser.errors();
+  return stats;
+}
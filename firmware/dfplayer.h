@@ -0,0 +1,60 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "dfplayer_frame.h"
+
+enum class DfEventType : uint8_t {
+  Ack,          // command accepted (0x41); `param` is the one it was sent with
+  Reply,        // answer to a query; `command` is the query code
+  Error,        // module error (0x40); `command` is the request in flight, if any
+  Timeout,      // no ack/reply within DFPLAYER_ACK_TIMEOUT_MS
+  TrackFinished,// unsolicited 0x3D, `param` is the finished track
+  CardInserted,
+  CardRemoved,
+  InitDone      // 0x3F after power-up or reset
+};
+
+struct DfEvent {
+  DfEventType type;
+  uint8_t command;
+  uint16_t param;
+  unsigned long at;
+};
+
+struct DfStats {
+  uint32_t queued;
+  uint32_t sent;
+  uint32_t dropped;
+  uint32_t cancelled;
+  uint32_t acks;
+  uint32_t timeouts;
+  uint32_t rxFrames;
+  uint32_t rxErrors;
+};
+
+// Non-blocking DFPlayer link. Commands go into a bounded ring and are
+// written from dfService() one at a time: the next frame leaves only after
+// the previous one was acknowledged (or answered, for queries) or timed out,
+// and never sooner than DFPLAYER_CMD_GAP_MS after it. Incoming frames are
+// parsed byte by byte and surfaced through dfPollEvent(). Nothing here waits
+// on the UART; frames are only written when the TX FIFO has room for them.
+//
+// Timed entries (dfSendAfter) additionally wait `afterMs` after the frame
+// before them, which lets a caller lay out a sequence such as a volume ramp
+// in one go. They can be withdrawn together with dfCancelTimed() when the
+// sequence is superseded; plain entries are never cancelled.
+void dfBegin();
+bool dfSend(uint8_t command, uint16_t param = 0);
+bool dfSendAfter(uint8_t command, uint16_t param, uint16_t afterMs);
+uint8_t dfCancelTimed();
+bool dfTimedPending();
+// Entries the ring can still take.
+uint8_t dfQueueFree();
+// Smoothed time from writing a command to its ack (0 until the first ack).
+uint16_t dfAckLatencyMs();
+void dfService(unsigned long now);
+bool dfPollEvent(DfEvent &ev);
+bool dfIdle();
+void dfFlushQueue();
+const DfStats &dfStats();
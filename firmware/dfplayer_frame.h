@@ -0,0 +1,130 @@
+#pragma once
+
+// DFPlayer Mini wire format, shared by the firmware driver and the host-side
+// emulator (tools/host). Plain C++ on purpose: no Arduino headers.
+//
+//   7E FF 06 CMD FB PH PL CH CL EF
+//
+// FB requests an 0x41 ack, PH/PL is the big-endian parameter and CH/CL the
+// big-endian two's complement of the sum of bytes 1..6.
+
+#include <stddef.h>
+#include <stdint.h>
+
+static const uint8_t DF_FRAME_LEN = 10;
+static const uint8_t DF_FRAME_START = 0x7E;
+static const uint8_t DF_FRAME_VERSION = 0xFF;
+static const uint8_t DF_FRAME_BODY_LEN = 0x06;
+static const uint8_t DF_FRAME_END = 0xEF;
+
+// Commands (host -> module).
+namespace DfCmd {
+static const uint8_t Next = 0x01;
+static const uint8_t Prev = 0x02;
+static const uint8_t PlayTrack = 0x03;
+static const uint8_t SetVolume = 0x06;
+static const uint8_t SetEq = 0x07;
+static const uint8_t Reset = 0x0C;
+static const uint8_t Resume = 0x0D;
+static const uint8_t Pause = 0x0E;
+static const uint8_t PlayFolder = 0x0F;
+static const uint8_t PlayMp3Folder = 0x12;
+static const uint8_t Stop = 0x16;
+static const uint8_t QueryStatus = 0x42;
+static const uint8_t QueryVolume = 0x43;
+static const uint8_t QueryEq = 0x44;
+static const uint8_t QueryTfFiles = 0x48;
+static const uint8_t QueryTfTrack = 0x4C;
+static const uint8_t QueryFolderFiles = 0x4E;
+static const uint8_t QueryFolders = 0x4F;
+}  // namespace DfCmd
+
+// Messages (module -> host). Query replies reuse the query code.
+namespace DfMsg {
+static const uint8_t CardInserted = 0x3A;
+static const uint8_t CardRemoved = 0x3B;
+static const uint8_t UsbFinished = 0x3C;
+static const uint8_t TfFinished = 0x3D;
+static const uint8_t InitDone = 0x3F;
+static const uint8_t Error = 0x40;
+static const uint8_t Ack = 0x41;
+}  // namespace DfMsg
+
+// Error codes carried by DfMsg::Error.
+namespace DfError {
+static const uint8_t Busy = 0x01;
+static const uint8_t Sleeping = 0x02;
+static const uint8_t SerialError = 0x03;
+static const uint8_t Checksum = 0x04;
+static const uint8_t OutOfRange = 0x05;
+static const uint8_t NotFound = 0x06;
+static const uint8_t CardFailure = 0x08;
+}  // namespace DfError
+
+inline bool dfIsQuery(uint8_t command) {
+  return command >= DfCmd::QueryStatus && command <= DfCmd::QueryFolders;
+}
+
+inline uint16_t dfFrameChecksum(const uint8_t *frame) {
+  uint16_t sum = 0;
+  for (uint8_t i = 1; i < 7; ++i) sum += frame[i];
+  return static_cast<uint16_t>(0 - sum);
+}
+
+inline void dfFrameEncode(uint8_t *frame, uint8_t command, uint16_t param, bool feedback) {
+  frame[0] = DF_FRAME_START;
+  frame[1] = DF_FRAME_VERSION;
+  frame[2] = DF_FRAME_BODY_LEN;
+  frame[3] = command;
+  frame[4] = feedback ? 1 : 0;
+  frame[5] = static_cast<uint8_t>(param >> 8);
+  frame[6] = static_cast<uint8_t>(param & 0xFF);
+  uint16_t sum = dfFrameChecksum(frame);
+  frame[7] = static_cast<uint8_t>(sum >> 8);
+  frame[8] = static_cast<uint8_t>(sum & 0xFF);
+  frame[9] = DF_FRAME_END;
+}
+
+struct DfFrame {
+  uint8_t command;
+  bool feedback;
+  uint16_t param;
+};
+
+// Byte-wise decoder. push() returns true when a complete, valid frame is
+// available in frame(); malformed input bumps errors() and resynchronises on
+// the next 0x7E.
+class DfFrameParser {
+ public:
+  bool push(uint8_t b) {
+    if (len == 0 && b != DF_FRAME_START) return false;
+    buf[len++] = b;
+    if (len == 3 && (buf[1] != DF_FRAME_VERSION || buf[2] != DF_FRAME_BODY_LEN)) {
+      errorCount++;
+      len = 0;
+      if (b == DF_FRAME_START) buf[len++] = b;
+      return false;
+    }
+    if (len < DF_FRAME_LEN) return false;
+    len = 0;
+    uint16_t sum = (static_cast<uint16_t>(buf[7]) << 8) | buf[8];
+    if (buf[9] != DF_FRAME_END || sum != dfFrameChecksum(buf)) {
+      errorCount++;
+      return false;
+    }
+    last.command = buf[3];
+    last.feedback = buf[4] != 0;
+    last.param = (static_cast<uint16_t>(buf[5]) << 8) | buf[6];
+    return true;
+  }
+
+  const DfFrame &frame() const { return last; }
+  uint32_t errors() const { return errorCount; }
+  void reset() { len = 0; }
+
+ private:
+  uint8_t buf[DF_FRAME_LEN] = {0};
+  uint8_t len = 0;
+  uint32_t errorCount = 0;
+  DfFrame last{0, false, 0};
+};
@@ -0,0 +1,35 @@
+#include "dial.h"
+
+static DialState dial{};
+
+void dialBegin(uint16_t current, uint16_t total) {
+  dial.total = total > 0 ? total : 1;
+  dial.count = 1;
+  for (uint16_t t = dial.total; t >= 10 && dial.count < DIAL_MAX_DIGITS; t /= 10) dial.count++;
+  uint16_t value = constrain(current, (uint16_t)1, dial.total);
+  for (int8_t i = dial.count - 1; i >= 0; --i) {
+    dial.digits[i] = value % 10;
+    value /= 10;
+  }
+  dial.cursor = dial.count - 1; // units: the nearest targets are a few steps away
+}
+
+void dialMove(int8_t delta) {
+  dial.cursor = constrain(dial.cursor + delta, 0, dial.count - 1);
+}
+
+void dialStep(int8_t delta) {
+  uint8_t &digit = dial.digits[dial.cursor];
+  digit = (digit + 10 + delta % 10) % 10;
+}
+
+uint16_t dialValue() {
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < dial.count; ++i) value = value * 10 + dial.digits[i];
+  if (value == 0) return 0;
+  return value > dial.total ? dial.total : value;
+}
+
+const DialState &dialState() {
+  return dial;
+}
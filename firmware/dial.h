@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+static const uint8_t DIAL_MAX_DIGITS = 5; // 99 folders x 255 files
+
+// Track dial: a track number entered digit by digit. It has as many digits
+// as the library's track count and starts on the current track. Nothing is
+// played while dialling; the caller plays dialValue() once on confirm.
+struct DialState {
+  uint8_t digits[DIAL_MAX_DIGITS]; // most significant first
+  uint8_t count;
+  uint8_t cursor;
+  uint16_t total;
+};
+
+void dialBegin(uint16_t current, uint16_t total);
+void dialMove(int8_t delta);  // cursor, stops at either end
+void dialStep(int8_t delta);  // digit under the cursor, wraps 9 -> 0
+// The dialled number clamped to the library, or 0 when all digits are 0.
+uint16_t dialValue();
+const DialState &dialState();
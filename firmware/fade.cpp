@@ -0,0 +1,92 @@
+#include "fade.h"
+
+#include "audio_backend.h"
+
+struct FadeStats {
+  uint32_t fades;
+  uint32_t steps;
+  uint16_t lastStepMs;
+  uint8_t lastSteps;
+};
+
+static FadeStats stats{};
+
+// Percent of the way through a fade-in at num/den, interpolated between the
+// evenly spaced AUDIO_FADE_CURVE points.
+static uint8_t curveAt(uint16_t num, uint16_t den) {
+  if (num >= den) return AUDIO_FADE_CURVE[AUDIO_FADE_CURVE_POINTS - 1];
+  uint32_t pos = static_cast<uint32_t>(num) * (AUDIO_FADE_CURVE_POINTS - 1) * 256 / den;
+  uint8_t i = pos >> 8;
+  uint8_t frac = pos & 0xFF;
+  return AUDIO_FADE_CURVE[i] + ((AUDIO_FADE_CURVE[i + 1] - AUDIO_FADE_CURVE[i]) * frac >> 8);
+}
+
+uint16_t fadeStepMs() {
+  // A step cannot leave before the previous one was acknowledged, so spacing
+  // them any closer than the ack latency would only bunch them up.
+  return max<uint16_t>(max<uint16_t>(AUDIO_FADE_STEP_MIN_MS, DFPLAYER_CMD_GAP_MS), AudioBackend::ackLatencyMs());
+}
+
+// Points of the curve a ramp is split into, and their spacing.
+static uint16_t planSteps(uint8_t span, uint16_t durationMs, uint16_t &stepMs) {
+  // A zero duration is a cut: one step, sent as soon as the link allows.
+  stepMs = durationMs > 0 ? fadeStepMs() : 0;
+  if (span == 0) return 0;
+  // Long fades (the sleep timer's) have more time than volume steps: spread
+  // the steps out instead of running them at link speed.
+  if (durationMs > 0) stepMs = max<uint16_t>(stepMs, durationMs / span);
+  return durationMs > 0 ? constrain(durationMs / stepMs, 1, span) : 1;
+}
+
+uint8_t fadeSteps(uint8_t from, uint8_t to, uint16_t durationMs) {
+  uint16_t stepMs;
+  return min<uint16_t>(planSteps(from > to ? from - to : to - from, durationMs, stepMs), DFPLAYER_QUEUE_LEN);
+}
+
+uint16_t fadeQueue(uint8_t from, uint8_t to, uint16_t durationMs, uint8_t reserve) {
+  uint8_t span = from > to ? from - to : to - from;
+  uint16_t stepMs;
+  uint16_t steps = planSteps(span, durationMs, stepMs);
+  if (steps == 0) return stepMs;
+  // A full ring drops the newest entries: the quietest steps and whatever
+  // should follow them.
+  uint8_t room = AudioBackend::queueFree();
+  room = room > reserve ? room - reserve : 1;
+  if (steps > room) {
+    steps = room;
+    if (durationMs > 0) stepMs = max<uint16_t>(stepMs, durationMs / steps);
+  }
+
+  uint8_t last = from;
+  uint8_t queued = 0;
+  uint16_t waitMs = 0; // a point of the curve that repeats a level still takes its time
+  for (uint16_t i = 1; i <= steps; ++i) {
+    uint8_t level = to > from ? from + span * curveAt(i, steps) / 100
+                              : to + span * curveAt(steps - i, steps) / 100;
+    waitMs += stepMs;
+    if (level == last) continue;
+    AudioBackend::sendAfter(DfCmd::SetVolume, level, waitMs);
+    waitMs = 0;
+    last = level;
+    queued++;
+  }
+  stats.fades++;
+  stats.steps += queued;
+  stats.lastStepMs = stepMs;
+  stats.lastSteps = queued;
+  return stepMs;
+}
+
+void fadePrintStats(Print &out) {
+  out.print("fade count=");
+  out.print(stats.fades);
+  out.print(" steps=");
+  out.print(stats.steps);
+  out.print(" last=");
+  out.print(stats.lastSteps);
+  out.print("x");
+  out.print(stats.lastStepMs);
+  out.print("ms ack=");
+  out.print(AudioBackend::ackLatencyMs());
+  out.println("ms");
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Queues a DFPlayer volume ramp from `from` to `to` over about `durationMs`,
+// shaped by AUDIO_FADE_CURVE, as timed entries (see dfSendAfter). Nothing
+// waits: the ramp plays out from AudioBackend::service(). A zero duration
+// queues a single step. Returns the spacing used, which the caller passes to
+// the command that should follow the ramp.
+//
+// The ramp never takes the last `reserve` free queue entries, which are kept
+// for the commands the caller queues after it (the Pause, a play). When the
+// queue has less room than the ramp has steps, it takes fewer, larger steps
+// over the same duration, still ending at `to`.
+uint16_t fadeQueue(uint8_t from, uint8_t to, uint16_t durationMs, uint8_t reserve = 0);
+// Queue entries fadeQueue() takes at most for this ramp, given the room.
+uint8_t fadeSteps(uint8_t from, uint8_t to, uint16_t durationMs);
+// Step spacing the next ramp would use, from the measured ack latency.
+uint16_t fadeStepMs();
+void fadePrintStats(Print &out);
@@ -0,0 +1,71 @@
+#include "governor.h"
+
+struct TierStats {
+  uint32_t frames;
+  uint32_t spiBytes;
+  uint32_t activeMs;
+};
+
+static TierStats tierStats[FRAME_TIER_COUNT];
+static uint8_t currentTier = 0;
+static unsigned long lastActivity = 0;
+static unsigned long lastSample = 0;
+
+void governorNoteActivity() {
+  lastActivity = millis();
+}
+
+unsigned long governorIdleMs(unsigned long now) {
+  return now - lastActivity;
+}
+
+uint8_t governorSelect(const BatteryStatus &battery, unsigned long now) {
+  uint8_t tier = FRAME_TIER_COUNT - 1;
+  for (uint8_t i = 0; i < FRAME_TIER_COUNT; ++i) {
+    if (battery.percent >= FRAME_TIERS[i].minPercent) {
+      tier = i;
+      break;
+    }
+  }
+  // Red is a hard floor regardless of what the percentage estimate says.
+  if (battery.level == BatteryLevel::Red && tier < FRAME_TIER_COUNT - 2) {
+    tier = FRAME_TIER_COUNT - 2;
+  }
+  if (now - lastActivity > UI_IDLE_AFTER_MS && tier < FRAME_TIER_COUNT - 1) {
+    tier++;
+  }
+  currentTier = tier;
+  return tier;
+}
+
+const FrameTier &governorTier() {
+  return FRAME_TIERS[currentTier];
+}
+
+void governorRecordFrame(uint32_t spiBytes, unsigned long now) {
+  TierStats &stats = tierStats[currentTier];
+  if (lastSample != 0) stats.activeMs += now - lastSample;
+  lastSample = now;
+  if (spiBytes == 0) return;
+  stats.frames++;
+  stats.spiBytes += spiBytes;
+}
+
+// Time while the panel is asleep belongs to no tier.
+void governorSkipFrame(unsigned long now) {
+  lastSample = now;
+}
+
+void governorPrintStats(Print &out) {
+  out.println("tier        fps    spiB/s   time_s");
+  for (uint8_t i = 0; i < FRAME_TIER_COUNT; ++i) {
+    const TierStats &stats = tierStats[i];
+    float seconds = stats.activeMs / 1000.0f;
+    float fps = seconds > 0 ? stats.frames / seconds : 0;
+    uint32_t bps = seconds > 0 ? static_cast<uint32_t>(stats.spiBytes / seconds) : 0;
+    char line[64];
+    snprintf(line, sizeof(line), "%c%-9s %6.1f %9lu %8lu", i == currentTier ? '*' : ' ', FRAME_TIERS[i].name, fps,
+             static_cast<unsigned long>(bps), static_cast<unsigned long>(stats.activeMs / 1000));
+    out.println(line);
+  }
+}
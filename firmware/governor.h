@@ -0,0 +1,13 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "power.h"
+
+void governorNoteActivity();
+unsigned long governorIdleMs(unsigned long now);
+uint8_t governorSelect(const BatteryStatus &battery, unsigned long now);
+const FrameTier &governorTier();
+void governorRecordFrame(uint32_t spiBytes, unsigned long now);
+void governorSkipFrame(unsigned long now);
+void governorPrintStats(Print &out);
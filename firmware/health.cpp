@@ -0,0 +1,110 @@
+#include "health.h"
+
+struct HealthStats {
+  uint32_t pings;
+  uint32_t timeouts;
+  uint32_t offlineEvents;
+  uint32_t retries;
+  uint32_t reconnects;
+  uint32_t downtimeMs;
+};
+
+static bool offline = false;
+static unsigned long lastHeardAt = 0;
+static unsigned long lastPingAt = 0;
+static uint8_t timeoutsInRow = 0;
+static unsigned long offlineSince = 0;
+static unsigned long nextRetryAt = 0;
+static uint8_t retryAttempt = 0;
+static HealthStats stats{};
+
+static uint32_t backoffMs(uint8_t attempt) {
+  uint32_t delayMs = DFPLAYER_RETRY_MIN_MS;
+  while (attempt-- > 0 && delayMs < DFPLAYER_RETRY_MAX_MS) delayMs *= 2;
+  delayMs = min(delayMs, DFPLAYER_RETRY_MAX_MS);
+  // Up to 1/8 jitter so a marginal supply does not see retries in lockstep.
+  return delayMs - (esp_random() % (delayMs / 8 + 1));
+}
+
+void healthOnline(unsigned long now) {
+  if (offline) {
+    stats.reconnects++;
+    stats.downtimeMs += now - offlineSince;
+  }
+  offline = false;
+  timeoutsInRow = 0;
+  retryAttempt = 0;
+  lastHeardAt = now;
+}
+
+void healthHeard(unsigned long now) {
+  lastHeardAt = now;
+  timeoutsInRow = 0;
+}
+
+void healthTimedOut() {
+  stats.timeouts++;
+  if (timeoutsInRow < 255) timeoutsInRow++;
+}
+
+bool healthPingDue(unsigned long now, uint32_t quietMs) {
+  if (offline) return false;
+  // After a miss, confirm quickly instead of waiting out another quiet spell.
+  if (timeoutsInRow > 0) return now - lastPingAt >= DFPLAYER_ACK_TIMEOUT_MS;
+  return now - lastHeardAt >= quietMs && now - lastPingAt >= quietMs;
+}
+
+void healthPingSent(unsigned long now) {
+  lastPingAt = now;
+  stats.pings++;
+}
+
+bool healthLost() {
+  return !offline && timeoutsInRow >= DFPLAYER_OFFLINE_TIMEOUTS;
+}
+
+void healthOffline(unsigned long now) {
+  if (offline) {
+    stats.retries++;
+    if (retryAttempt < 16) retryAttempt++;
+  } else {
+    offline = true;
+    offlineSince = now;
+    stats.offlineEvents++;
+    retryAttempt = 0;
+  }
+  nextRetryAt = now + backoffMs(retryAttempt);
+}
+
+bool healthRetryDue(unsigned long now) {
+  return offline && static_cast<long>(now - nextRetryAt) >= 0;
+}
+
+void healthRetryNow(unsigned long now) {
+  nextRetryAt = now;
+}
+
+void healthPrintStats(Print &out, unsigned long now) {
+  out.print("health ");
+  out.print(offline ? "offline" : "online");
+  if (offline) {
+    out.print(" for=");
+    out.print(now - offlineSince);
+    out.print("ms nextRetry=");
+    out.print(static_cast<long>(nextRetryAt - now));
+    out.print("ms");
+  }
+  out.print(" pings=");
+  out.print(stats.pings);
+  out.print(" timeouts=");
+  out.print(stats.timeouts);
+  out.print(" drops=");
+  out.print(stats.offlineEvents);
+  out.print(" retries=");
+  out.print(stats.retries);
+  out.print(" reconnects=");
+  out.print(stats.reconnects);
+  out.print(" downtime=");
+  out.print(stats.downtimeMs + (offline ? now - offlineSince : 0));
+  out.println("ms");
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// DFPlayer liveness. Any frame from the module counts as a sign of life;
+// when the link has been quiet for the caller's interval a cheap status query
+// is due, and DFPLAYER_OFFLINE_TIMEOUTS unanswered requests in a row mark the
+// module offline. While offline, re-initialization is attempted on an
+// exponential backoff between DFPLAYER_RETRY_MIN_MS and DFPLAYER_RETRY_MAX_MS.
+void healthOnline(unsigned long now);
+void healthHeard(unsigned long now);
+void healthTimedOut();
+// audio.cpp passes DFPLAYER_PING_MS while playback is changing, and the
+// reconcile interval once it has settled, when its rounds are the check.
+bool healthPingDue(unsigned long now, uint32_t quietMs);
+void healthPingSent(unsigned long now);
+bool healthLost();
+// Link declared down, or a re-init probe went unanswered: schedule the next
+// probe, backing off further each time.
+void healthOffline(unsigned long now);
+bool healthRetryDue(unsigned long now);
+void healthRetryNow(unsigned long now);
+void healthPrintStats(Print &out, unsigned long now);
@@ -1,5 +1,9 @@
 #include "input.h"
 
+#include <driver/gpio.h>
+
+#include "latency.h"
+
 struct ButtonState {
   uint8_t pin;
   bool activeHigh;
@@ -9,15 +13,47 @@ struct ButtonState {
   unsigned long pressedAt;
   unsigned long lastChange;
   unsigned long lastRepeat;
+  bool edgeIrq;                    // edges timed by a pin-change interrupt
+  volatile unsigned long edgeUs;   // first edge of the latest bounce burst
+  volatile unsigned long lastEdgeUs;
 };
 
-static ButtonState touchPlay{PIN_TOUCH_PLAY, true, false, false, false, 0, 0, 0};
-static ButtonState touchNext{PIN_TOUCH_NEXT, true, false, false, false, 0, 0, 0};
-static ButtonState touchPrev{PIN_TOUCH_PREV, true, false, false, false, 0, 0, 0};
-static ButtonState btnVolDown{PIN_BTN_VOL_DOWN, false, true, true, false, 0, 0, 0};
-static ButtonState btnVolUp{PIN_BTN_VOL_UP, false, true, true, false, 0, 0, 0};
+static ButtonState touchPlay{PIN_TOUCH_PLAY, true, false, false, false, 0, 0, 0, true, 0, 0};
+static ButtonState touchNext{PIN_TOUCH_NEXT, true, false, false, false, 0, 0, 0, true, 0, 0};
+static ButtonState touchPrev{PIN_TOUCH_PREV, true, false, false, false, 0, 0, 0, true, 0, 0};
+static ButtonState btnVolDown{PIN_BTN_VOL_DOWN, false, true, true, false, 0, 0, 0, false, 0, 0};
+static ButtonState btnVolUp{PIN_BTN_VOL_UP, false, true, true, false, 0, 0, 0, false, 0, 0};
 static unsigned long comboStartMs = 0;
 static bool comboFired = false;
+static bool chordHeld = false; // Prev+Next pressed together; their releases are swallowed
+
+// Edge timestamps feed latency tracing only; button logic stays polled. The
+// touch pins get a pin-change interrupt so time spent before the next poll is
+// measured too. The volume buttons share GPIO 21/22 with the I2C bus, where an
+// interrupt would fire on every clock, so their edges are timed when polled.
+static void IRAM_ATTR noteEdge(ButtonState &btn) {
+  unsigned long now = micros();
+  if (now - btn.lastEdgeUs > DEBOUNCE_MS * 1000UL) btn.edgeUs = now;
+  btn.lastEdgeUs = now;
+}
+
+static void IRAM_ATTR playEdge() {
+  noteEdge(touchPlay);
+}
+
+static void IRAM_ATTR nextEdge() {
+  noteEdge(touchNext);
+}
+
+static void IRAM_ATTR prevEdge() {
+  noteEdge(touchPrev);
+}
+
+static InputEvent traced(InputEvent ev, const ButtonState &btn) {
+  unsigned long now = micros();
+  if (now - btn.edgeUs < LATENCY_TRACE_WINDOW_MS * 1000UL) latencyBegin(btn.edgeUs, now);
+  return ev;
+}
 
 static void primeButton(ButtonState &btn) {
   bool reading = digitalRead(btn.pin);
@@ -39,6 +75,7 @@ static bool updateButton(ButtonState &btn) {
   unsigned long now = millis();
 
   if (pressed != btn.lastReading) {
+    if (!btn.edgeIrq) noteEdge(btn);
     btn.lastChange = now;
     btn.lastReading = pressed;
   }
@@ -71,6 +108,12 @@ static bool shouldRepeat(ButtonState &btn, unsigned long now) {
   return false;
 }
 
+static void attachEdgeInterrupts() {
+  attachInterrupt(digitalPinToInterrupt(PIN_TOUCH_PLAY), playEdge, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PIN_TOUCH_NEXT), nextEdge, CHANGE);
+  attachInterrupt(digitalPinToInterrupt(PIN_TOUCH_PREV), prevEdge, CHANGE);
+}
+
 void inputInit() {
   pinMode(PIN_TOUCH_PLAY, INPUT);
   pinMode(PIN_TOUCH_NEXT, INPUT);
@@ -84,15 +127,67 @@ void inputInit() {
   primeButton(touchPrev);
   primeButton(btnVolDown);
   primeButton(btnVolUp);
+
+  attachEdgeInterrupts();
+}
+
+void inputArmWake() {
+  // A level wake source replaces the pin's edge interrupt until inputWake().
+  for (uint8_t pin : {PIN_TOUCH_PLAY, PIN_TOUCH_NEXT, PIN_TOUCH_PREV}) {
+    detachInterrupt(digitalPinToInterrupt(pin));
+    gpio_wakeup_enable(static_cast<gpio_num_t>(pin), GPIO_INTR_HIGH_LEVEL);
+  }
+}
+
+void inputWake() {
+  for (uint8_t pin : {PIN_TOUCH_PLAY, PIN_TOUCH_NEXT, PIN_TOUCH_PREV}) {
+    gpio_wakeup_disable(static_cast<gpio_num_t>(pin));
+  }
+  attachEdgeInterrupts();
+  // Priming takes whatever is held as the resting state, so the touch that
+  // woke us produces no event, not even on release.
+  primeButton(touchPlay);
+  primeButton(touchNext);
+  primeButton(touchPrev);
+  primeButton(btnVolDown);
+  primeButton(btnVolUp);
+  chordHeld = false;
+  comboStartMs = 0;
 }
 
 InputEvent inputPoll() {
   unsigned long now = millis();
 
-  // Update touch buttons (edge detection only)
-  if (updateButton(touchPrev)) return InputEvent::Prev;
-  if (updateButton(touchPlay)) return InputEvent::PlayPause;
-  if (updateButton(touchNext)) return InputEvent::Next;
+  // Touch buttons act on release, so a long hold can mean something else and
+  // Prev+Next together can be a chord rather than two skips.
+  bool prevWasPressed = touchPrev.stablePressed;
+  bool nextWasPressed = touchNext.stablePressed;
+  unsigned long prevPressedAt = touchPrev.pressedAt;
+  unsigned long nextPressedAt = touchNext.pressedAt;
+  updateButton(touchPrev);
+  updateButton(touchNext);
+  if (touchPrev.stablePressed && touchNext.stablePressed) {
+    if (!chordHeld) {
+      chordHeld = true;
+      return traced(InputEvent::TrackDial, touchPrev.pressedAt > touchNext.pressedAt ? touchPrev : touchNext);
+    }
+  } else if (chordHeld) {
+    // Releasing a chord is not a tap; it ends once both pads are up.
+    if (!touchPrev.stablePressed && !touchNext.stablePressed) chordHeld = false;
+  } else if (prevWasPressed && !touchPrev.stablePressed) {
+    return traced((now - prevPressedAt >= TOUCH_HOLD_MS) ? InputEvent::FavoriteToggle : InputEvent::Prev, touchPrev);
+  } else if (nextWasPressed && !touchNext.stablePressed) {
+    return traced((now - nextPressedAt >= TOUCH_HOLD_MS) ? InputEvent::NextFolder : InputEvent::Next, touchNext);
+  }
+
+  bool playWasPressed = touchPlay.stablePressed;
+  unsigned long playPressedAt = touchPlay.pressedAt;
+  updateButton(touchPlay);
+  if (playWasPressed && !touchPlay.stablePressed) {
+    unsigned long held = now - playPressedAt;
+    if (held >= SETTINGS_HOLD_MS) return traced(InputEvent::SettingsOpen, touchPlay);
+    return traced((held >= TOUCH_HOLD_MS) ? InputEvent::ShuffleToggle : InputEvent::PlayPause, touchPlay);
+  }
 
   // Update mechanical volume buttons with repeat
   bool volDownPressed = updateButton(btnVolDown); // left = volume down
@@ -113,8 +208,8 @@ InputEvent inputPoll() {
   }
 
   if (!bothPressed) {
-    if (volUpPressed) return InputEvent::VolUp;
-    if (volDownPressed) return InputEvent::VolDown;
+    if (volUpPressed) return traced(InputEvent::VolUp, btnVolUp);
+    if (volDownPressed) return traced(InputEvent::VolDown, btnVolDown);
 
     if (shouldRepeat(btnVolUp, now)) return InputEvent::VolUp;
     if (shouldRepeat(btnVolDown, now)) return InputEvent::VolDown;
@@ -6,8 +6,13 @@
 enum class InputEvent {
   None,
   PlayPause,
+  ShuffleToggle,
+  SettingsOpen,
+  TrackDial,
   Next,
+  NextFolder,
   Prev,
+  FavoriteToggle,
   VolUp,
   VolDown,
   ModeToggle
@@ -15,4 +20,8 @@ enum class InputEvent {
 
 void inputInit();
 InputEvent inputPoll();
+// Light sleep: wake on any touch pad (volume keys sit on the I2C pins). After
+// waking, inputWake() restores edge timing and swallows the waking touch.
+void inputArmWake();
+void inputWake();
 
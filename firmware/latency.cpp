@@ -0,0 +1,109 @@
+#include "latency.h"
+
+#include "dfplayer_frame.h"
+
+// Histogram bucket upper bounds in ms; the last bucket takes the rest.
+static const uint16_t BUCKET_MS[] = {1, 2, 5, 10, 20, 50, 100, 200, 500};
+static const uint8_t BUCKET_COUNT = sizeof(BUCKET_MS) / sizeof(BUCKET_MS[0]) + 1;
+static const char *const STAGE_NAMES[LATENCY_STAGE_COUNT] = {"accept", "dispatch", "txStart", "txDone",
+                                                             "ack", "playTx", "ui"};
+// 10 bits per byte on the wire.
+static const uint32_t FRAME_WIRE_US = DF_FRAME_LEN * 10UL * 1000000UL / DFPLAYER_BAUD;
+
+struct StageHistogram {
+  uint32_t count;
+  uint64_t totalUs;
+  uint32_t maxUs;
+  uint16_t buckets[BUCKET_COUNT];
+};
+
+static StageHistogram histograms[LATENCY_STAGE_COUNT];
+static uint32_t traces = 0;
+static bool active = false;
+static unsigned long edgeAt = 0;
+static uint8_t marked = 0;   // bit per LatencyStage already recorded
+static uint8_t frameCommand = 0;
+
+static bool has(LatencyStage stage) {
+  return marked & (1 << static_cast<uint8_t>(stage));
+}
+
+static void record(LatencyStage stage, unsigned long atUs) {
+  uint8_t i = static_cast<uint8_t>(stage);
+  marked |= 1 << i;
+  uint32_t us = atUs - edgeAt;
+  StageHistogram &h = histograms[i];
+  h.count++;
+  h.totalUs += us;
+  if (us > h.maxUs) h.maxUs = us;
+  uint8_t b = 0;
+  while (b < BUCKET_COUNT - 1 && us >= BUCKET_MS[b] * 1000UL) ++b;
+  h.buckets[b]++;
+}
+
+// Ends the trace once its window has passed; false if none is open.
+static bool traceOpen(unsigned long nowUs) {
+  if (active && nowUs - edgeAt > LATENCY_TRACE_WINDOW_MS * 1000UL) active = false;
+  return active;
+}
+
+void latencyBegin(unsigned long edgeUs, unsigned long acceptUs) {
+  active = true;
+  edgeAt = edgeUs;
+  marked = 0;
+  traces++;
+  record(LatencyStage::Accept, acceptUs);
+}
+
+void latencyMark(LatencyStage stage, unsigned long atUs) {
+  if (!traceOpen(atUs) || has(stage)) return;
+  // Everything after dispatch must follow it, or it belongs to earlier activity.
+  if (stage != LatencyStage::Dispatch && !has(LatencyStage::Dispatch)) return;
+  record(stage, atUs);
+}
+
+void latencyFrameSent(uint8_t command, unsigned long startUs) {
+  if (!traceOpen(startUs) || !has(LatencyStage::Dispatch)) return;
+  if (!has(LatencyStage::TxStart)) {
+    frameCommand = command;
+    record(LatencyStage::TxStart, startUs);
+    record(LatencyStage::TxDone, startUs + FRAME_WIRE_US);
+  }
+  if (!has(LatencyStage::PlayTx) && (command == DfCmd::PlayMp3Folder || command == DfCmd::PlayFolder)) {
+    record(LatencyStage::PlayTx, startUs + FRAME_WIRE_US);
+  }
+}
+
+void latencyFrameAcked(uint8_t command, unsigned long atUs) {
+  if (!traceOpen(atUs) || !has(LatencyStage::TxStart) || has(LatencyStage::Ack) || command != frameCommand) return;
+  record(LatencyStage::Ack, atUs);
+}
+
+void latencyReset() {
+  memset(histograms, 0, sizeof(histograms));
+  traces = 0;
+  active = false;
+}
+
+void latencyPrintStats(Print &out) {
+  out.print("latency ms from input edge, traces=");
+  out.println(traces);
+  out.print("stage        n    avg    max |");
+  for (uint8_t b = 0; b < BUCKET_COUNT - 1; ++b) {
+    out.print(" <");
+    out.print(BUCKET_MS[b]);
+  }
+  out.println(" more");
+  for (uint8_t i = 0; i < LATENCY_STAGE_COUNT; ++i) {
+    const StageHistogram &h = histograms[i];
+    char row[40];
+    snprintf(row, sizeof(row), "%-9s %4lu %6.1f %6.1f |", STAGE_NAMES[i], static_cast<unsigned long>(h.count),
+             h.count ? h.totalUs / 1000.0 / h.count : 0.0, h.maxUs / 1000.0);
+    out.print(row);
+    for (uint8_t b = 0; b < BUCKET_COUNT; ++b) {
+      out.print(' ');
+      out.print(h.buckets[b]);
+    }
+    out.println();
+  }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Input-to-audio latency tracing. A trace starts at the GPIO edge behind an
+// input event (timed by a pin-change interrupt, so loop stalls show up) and
+// records when each later stage of the pipeline first happened, in
+// microseconds from that edge. Every stage feeds its own histogram. A trace
+// ends at the next traced edge or LATENCY_TRACE_WINDOW_MS after it began;
+// stages that did not happen by then, such as a tap that sent no command,
+// are simply not counted.
+enum class LatencyStage : uint8_t {
+  Accept,   // debounce accepted the edge (input.cpp)
+  Dispatch, // loop() acted on the event
+  TxStart,  // first DFPlayer frame after dispatch handed to the UART
+  TxDone,   // its last byte on the wire, from the frame length at DFPLAYER_BAUD
+  Ack,      // its ack processed
+  PlayTx,   // last byte of a play command on the wire
+  Ui        // first panel redraw showing the change
+};
+static const uint8_t LATENCY_STAGE_COUNT = 7;
+
+void latencyBegin(unsigned long edgeUs, unsigned long acceptUs);
+void latencyMark(LatencyStage stage, unsigned long atUs);
+void latencyFrameSent(uint8_t command, unsigned long startUs);
+void latencyFrameAcked(uint8_t command, unsigned long atUs);
+void latencyReset();
+void latencyPrintStats(Print &out);
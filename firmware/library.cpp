@@ -0,0 +1,240 @@
+#include "library.h"
+
+#include <Preferences.h>
+
+#include "audio_backend.h"
+
+static const uint8_t HINT_BUCKETS = 32;
+static const uint8_t CACHE_VERSION = 1;
+
+// Last known shape, as stored in NVS. cardFiles (the module's total file
+// count) doubles as a cheap fingerprint of the card.
+struct LibraryCache {
+  uint8_t version;
+  uint8_t reserved;
+  uint16_t cardFiles;
+  uint8_t folderFiles[LIBRARY_MAX_FOLDER + 1];
+};
+
+static uint8_t folderFiles[LIBRARY_MAX_FOLDER + 1]; // [1..99]
+static uint16_t folderStart[LIBRARY_MAX_FOLDER + 2]; // tracks before folder f
+static uint8_t bucketHint[HINT_BUCKETS];             // folder holding the bucket's first track
+static uint16_t bucketSize = 1;
+static uint16_t total = 0;
+static uint8_t nonEmptyFolders = 0;
+static bool flat = true;
+static bool ready = false;
+static uint16_t cardFiles = 0;
+
+static Preferences prefs;
+static LibraryCache cache{};    // mirrors NVS
+static bool fromCache = false;  // tables came from NVS and are not verified yet
+static uint16_t cacheWrites = 0;
+static uint16_t verifyChanges = 0;
+
+// Background scan
+// Counts land in scanFiles so the live tables keep serving lookups until the
+// scan ends; they are only replaced when the card turned out different.
+static bool scanning = false;
+static bool scanCounting = false; // verify scans start with 0x48
+static uint8_t scanFiles[LIBRARY_MAX_FOLDER + 1];
+static uint16_t scanCardFiles = 0;
+static uint8_t scanExpected = 0;
+static uint8_t scanFolder = 0;
+static uint8_t scanFound = 0;
+static unsigned long scanStartedAt = 0;
+static uint32_t scanMs = 0;
+static uint16_t scanQueries = 0;
+static uint16_t scanTimeouts = 0;
+
+static void buildTables() {
+  folderStart[0] = 0;
+  folderStart[1] = 0;
+  nonEmptyFolders = 0;
+  for (uint8_t f = 1; f <= LIBRARY_MAX_FOLDER; ++f) {
+    folderStart[f + 1] = folderStart[f] + folderFiles[f];
+    if (folderFiles[f]) nonEmptyFolders++;
+  }
+  total = folderStart[LIBRARY_MAX_FOLDER + 1];
+  flat = total == 0;
+  if (flat) {
+    total = cardFiles > 0 ? cardFiles : 1; // Stable fallback: assume single track available
+    return;
+  }
+  bucketSize = (total + HINT_BUCKETS - 1) / HINT_BUCKETS;
+  uint8_t f = 1;
+  for (uint8_t b = 0; b < HINT_BUCKETS; ++b) {
+    uint16_t first = b * bucketSize;
+    while (f < LIBRARY_MAX_FOLDER && folderStart[f + 1] <= first) f++;
+    bucketHint[b] = f;
+  }
+}
+
+static void saveCache() {
+  if (cache.version == CACHE_VERSION && cache.cardFiles == cardFiles &&
+      memcmp(cache.folderFiles, folderFiles, sizeof(folderFiles)) == 0) {
+    return;
+  }
+  cache.version = CACHE_VERSION;
+  cache.cardFiles = cardFiles;
+  memcpy(cache.folderFiles, folderFiles, sizeof(folderFiles));
+  prefs.putBytes("shape", &cache, sizeof(cache));
+  cacheWrites++;
+}
+
+// True when the tables changed (always, for a first scan).
+static bool finishScan(unsigned long now) {
+  scanning = false;
+  scanMs = now - scanStartedAt;
+  bool changed = !ready || scanCardFiles != cardFiles || memcmp(scanFiles, folderFiles, sizeof(folderFiles)) != 0;
+  if (ready && changed) verifyChanges++;
+  fromCache = false;
+  if (changed) {
+    memcpy(folderFiles, scanFiles, sizeof(folderFiles));
+    cardFiles = scanCardFiles;
+    buildTables();
+    ready = true;
+  }
+  saveCache();
+  return changed;
+}
+
+static void queryFolder(uint8_t folder) {
+  scanFolder = folder;
+  scanQueries++;
+  AudioBackend::send(DfCmd::QueryFolderFiles, folder);
+}
+
+static void beginScan(unsigned long now) {
+  memset(scanFiles, 0, sizeof(scanFiles));
+  scanning = true;
+  scanCounting = false;
+  scanExpected = scanFound = scanFolder = 0;
+  scanStartedAt = now;
+  scanQueries = 1;
+  scanTimeouts = 0;
+}
+
+bool libraryLoadCache() {
+  prefs.begin("library", false);
+  if (prefs.getBytes("shape", &cache, sizeof(cache)) != sizeof(cache) || cache.version != CACHE_VERSION) {
+    cache = LibraryCache{};
+    return false;
+  }
+  memcpy(folderFiles, cache.folderFiles, sizeof(folderFiles));
+  folderFiles[0] = 0;
+  cardFiles = cache.cardFiles;
+  buildTables();
+  ready = true;
+  fromCache = true;
+  return true;
+}
+
+void libraryScanStart(uint16_t files, unsigned long now) {
+  ready = false;
+  beginScan(now);
+  scanCardFiles = files;
+  AudioBackend::send(DfCmd::QueryFolders);
+}
+
+void libraryVerifyStart(unsigned long now) {
+  beginScan(now);
+  scanCounting = true;
+  AudioBackend::send(DfCmd::QueryTfFiles);
+}
+
+bool libraryHandleEvent(const DfEvent &ev, bool &consumed) {
+  consumed = false;
+  if (!scanning) return false;
+  bool reply = ev.type == DfEventType::Reply;
+  bool failed = ev.type == DfEventType::Error || ev.type == DfEventType::Timeout;
+  if (!(reply || failed)) return false;
+
+  if (ev.command == DfCmd::QueryTfFiles && scanCounting) {
+    consumed = true;
+    scanCounting = false;
+    scanCardFiles = reply ? ev.param : 0;
+    scanQueries++;
+    AudioBackend::send(DfCmd::QueryFolders);
+    return false;
+  }
+  if (ev.command == DfCmd::QueryFolders) {
+    consumed = true;
+    scanExpected = reply ? static_cast<uint8_t>(min<uint16_t>(ev.param, LIBRARY_MAX_FOLDER)) : 0;
+    if (scanExpected == 0) return finishScan(ev.at);
+    queryFolder(1);
+    return false;
+  }
+  if (ev.command != DfCmd::QueryFolderFiles) return false;
+
+  // Missing folders answer with an error; a timeout counts as empty too.
+  consumed = true;
+  if (ev.type == DfEventType::Timeout) scanTimeouts++;
+  uint16_t files = reply ? min<uint16_t>(ev.param, 255) : 0;
+  scanFiles[scanFolder] = static_cast<uint8_t>(files);
+  if (files) scanFound++;
+  if (scanFound >= scanExpected || scanFolder >= LIBRARY_MAX_FOLDER) return finishScan(ev.at);
+  queryFolder(scanFolder + 1);
+  return false;
+}
+
+bool libraryReady() {
+  return ready;
+}
+
+bool libraryFlat() {
+  return flat;
+}
+
+uint16_t libraryTotal() {
+  return total;
+}
+
+TrackLocation libraryLocate(uint16_t track) {
+  track = constrain(track, (uint16_t)1, total);
+  if (flat) return TrackLocation{0, track};
+  uint16_t index = track - 1;
+  uint8_t f = bucketHint[index / bucketSize];
+  while (folderStart[f + 1] <= index) f++;
+  return TrackLocation{f, static_cast<uint16_t>(index - folderStart[f] + 1)};
+}
+
+uint16_t libraryTrackOf(const TrackLocation &loc) {
+  if (flat) return (loc.folder == 0 && loc.file >= 1 && loc.file <= total) ? loc.file : 0;
+  if (loc.folder < 1 || loc.folder > LIBRARY_MAX_FOLDER) return 0;
+  if (loc.file < 1 || loc.file > folderFiles[loc.folder]) return 0;
+  return folderStart[loc.folder] + loc.file;
+}
+
+uint16_t libraryFolderStep(uint16_t track, int8_t direction) {
+  if (flat || nonEmptyFolders == 0) return track;
+  uint8_t f = libraryLocate(track).folder;
+  do {
+    f = direction > 0 ? (f >= LIBRARY_MAX_FOLDER ? 1 : f + 1) : (f <= 1 ? LIBRARY_MAX_FOLDER : f - 1);
+  } while (folderFiles[f] == 0);
+  return folderStart[f] + 1;
+}
+
+void libraryPrintStats(Print &out) {
+  out.print("library ");
+  if (!ready) {
+    out.print(scanning ? "scanning folder " : "idle ");
+    out.println(scanFolder);
+    return;
+  }
+  if (fromCache) out.print(scanning ? "cached (verifying) " : "cached ");
+  out.print(flat ? "flat /mp3" : "folders=");
+  if (!flat) out.print(nonEmptyFolders);
+  out.print(" tracks=");
+  out.print(total);
+  out.print(" scan=");
+  out.print(scanMs);
+  out.print("ms queries=");
+  out.print(scanQueries);
+  out.print(" timeouts=");
+  out.print(scanTimeouts);
+  out.print(" cacheWrites=");
+  out.print(cacheWrites);
+  out.print(" changedAfterVerify=");
+  out.println(verifyChanges);
+}
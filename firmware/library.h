@@ -0,0 +1,42 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "dfplayer.h"
+
+// Shape of the SD card. Tracks are numbered 1..total across /01../99 in
+// folder order; a prefix-sum table turns a folder/file into a track number
+// and a bucket hint table turns a track number back into its folder after at
+// most a few steps. A card without numbered folders is flat: track N is
+// /mp3/NNNN.mp3, as the firmware always assumed.
+//
+// Per-folder counts are read in the background once the link is up (0x4F,
+// then 0x4E per folder until every reported folder has been seen), through
+// the same command queue as playback.
+//
+// The last scanned shape is kept in NVS (namespace "library") with the
+// card's total file count as a fingerprint. At boot the cached tables are
+// used straight away and a verify scan runs behind playback; the cache is
+// rewritten only when the card turned out different.
+struct TrackLocation {
+  uint8_t folder; // 0 = /mp3
+  uint16_t file;
+};
+
+static const uint8_t LIBRARY_MAX_FOLDER = 99;
+
+bool libraryLoadCache(); // true: tables are ready from NVS
+void libraryScanStart(uint16_t cardFiles, unsigned long now);
+// Rescans with the current tables still in use, starting from 0x48.
+void libraryVerifyStart(unsigned long now);
+// Consumes replies to the scan's queries. Returns true when a scan finishes
+// and the tables changed: always for libraryScanStart(), only if the card
+// differs from the cached shape for libraryVerifyStart().
+bool libraryHandleEvent(const DfEvent &ev, bool &consumed);
+bool libraryReady();
+bool libraryFlat();
+uint16_t libraryTotal();
+TrackLocation libraryLocate(uint16_t track);
+uint16_t libraryTrackOf(const TrackLocation &loc); // 0 if not in the library
+uint16_t libraryFolderStep(uint16_t track, int8_t direction); // first track of the next/previous album
+void libraryPrintStats(Print &out);
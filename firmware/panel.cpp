@@ -0,0 +1,245 @@
+#include "panel.h"
+
+static const uint8_t CMD_SLPIN = 0x10;
+static const uint8_t CMD_SLPOUT = 0x11;
+static const uint8_t CMD_IDMOFF = 0x38;
+static const uint8_t CMD_IDMON = 0x39;
+
+alignas(4) static uint8_t uiArena[UI_ARENA_BYTES];
+static size_t uiArenaTop = 0;
+
+void *uiArenaAlloc(size_t bytes) {
+  size_t aligned = (bytes + 3) & ~static_cast<size_t>(3);
+  if (aligned > UI_ARENA_BYTES - uiArenaTop) return nullptr;
+  void *block = &uiArena[uiArenaTop];
+  uiArenaTop += aligned;
+  return block;
+}
+
+void uiArenaRelease(void *block) {
+  if (!block) return;
+  uint8_t *p = static_cast<uint8_t *>(block);
+  if (p < uiArena || p >= uiArena + UI_ARENA_BYTES) return;
+  uiArenaTop = static_cast<size_t>(p - uiArena);
+}
+
+size_t uiArenaUsed() {
+  return uiArenaTop;
+}
+
+Panel::Panel(int8_t cs, int8_t dc, int8_t mosi, int8_t sck, int8_t rst)
+    : Adafruit_GC9A01A(cs, dc, mosi, sck, rst) {}
+
+void Panel::fillSaved(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  for (int16_t row = 0; row < h; ++row) {
+    uint16_t *dst = saveBuf + (y + row - saveRect.y) * saveRect.w + (x - saveRect.x);
+    for (int16_t col = 0; col < w; ++col) dst[col] = color;
+  }
+}
+
+void Panel::glassFill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, bool inWrite) {
+  int16_t cw = min<int16_t>(width(), x + w) - max<int16_t>(0, x);
+  int16_t ch = min<int16_t>(height(), y + h) - max<int16_t>(0, y);
+  if (cw <= 0 || ch <= 0) return;
+  glassBytes += PANEL_WINDOW_OVERHEAD_BYTES + static_cast<uint32_t>(cw) * ch * sizeof(uint16_t);
+  if (inWrite) {
+    Adafruit_GC9A01A::writeFillRect(x, y, w, h, color);
+  } else {
+    Adafruit_GC9A01A::fillRect(x, y, w, h, color);
+  }
+}
+
+void Panel::glassBitmap(int16_t x, int16_t y, uint16_t *pixels, int16_t w, int16_t h) {
+  if (w <= 0 || h <= 0) return;
+  glassBytes += PANEL_WINDOW_OVERHEAD_BYTES + static_cast<uint32_t>(w) * h * sizeof(uint16_t);
+  Adafruit_GC9A01A::drawRGBBitmap(x, y, pixels, w, h);
+}
+
+void Panel::fillRouted(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, bool inWrite) {
+  if (w <= 0 || h <= 0) return;
+  if (!redirecting()) {
+    glassFill(x, y, w, h, color, inWrite);
+    return;
+  }
+  bool toGlass = saveState != SaveState::Capturing;
+  int16_t ix0 = max<int16_t>(x, saveRect.x);
+  int16_t iy0 = max<int16_t>(y, saveRect.y);
+  int16_t ix1 = min<int16_t>(x + w, saveRect.x + saveRect.w);
+  int16_t iy1 = min<int16_t>(y + h, saveRect.y + saveRect.h);
+
+  if (ix0 >= ix1 || iy0 >= iy1) {
+    if (toGlass) glassFill(x, y, w, h, color, inWrite);
+    return;
+  }
+
+  fillSaved(ix0, iy0, ix1 - ix0, iy1 - iy0, color);
+  if (!toGlass) return;
+
+  // Up to four bands around the covered part still go to the glass.
+  PanelRect bands[4] = {
+      {x, y, w, static_cast<int16_t>(iy0 - y)},
+      {x, iy1, w, static_cast<int16_t>(y + h - iy1)},
+      {x, iy0, static_cast<int16_t>(ix0 - x), static_cast<int16_t>(iy1 - iy0)},
+      {ix1, iy0, static_cast<int16_t>(x + w - ix1), static_cast<int16_t>(iy1 - iy0)},
+  };
+  for (const PanelRect &b : bands) {
+    if (b.w > 0 && b.h > 0) glassFill(b.x, b.y, b.w, b.h, color, inWrite);
+  }
+}
+
+void Panel::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  fillRouted(x, y, 1, 1, color, false);
+}
+
+void Panel::writePixel(int16_t x, int16_t y, uint16_t color) {
+  fillRouted(x, y, 1, 1, color, true);
+}
+
+void Panel::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  fillRouted(x, y, w, h, color, true);
+}
+
+void Panel::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  fillRouted(x, y, w, 1, color, true);
+}
+
+void Panel::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  fillRouted(x, y, 1, h, color, true);
+}
+
+void Panel::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  fillRouted(x, y, w, h, color, false);
+}
+
+void Panel::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  fillRouted(x, y, w, 1, color, false);
+}
+
+void Panel::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  fillRouted(x, y, 1, h, color, false);
+}
+
+// Two RGB565 pixels per 32-bit word. Every per-channel op below keeps each
+// field within its own bits, so no carry or borrow crosses a channel.
+static inline uint32_t fxHalf(uint32_t v) {
+  return (v >> 1) & 0x7BEF7BEF;
+}
+
+static inline uint32_t fxThreeQuarter(uint32_t v) {
+  return v - ((v >> 2) & 0x39E739E7);
+}
+
+static inline uint32_t fxAverage(uint32_t v, uint32_t t) {
+  return (v & t) + (((v ^ t) & 0xF7DEF7DE) >> 1);
+}
+
+static void applyLineFx(uint16_t *px, int16_t w, uint8_t fx) {
+  const uint32_t tint = (static_cast<uint32_t>(COLOR_WARNING) << 16) | COLOR_WARNING;
+  int16_t i = 0;
+  for (; i + 1 < w; i += 2) {
+    uint32_t v;
+    memcpy(&v, px + i, sizeof(v));
+    if (fx & PANEL_FX_TINT) v = fxAverage(v, tint);
+    if (fx & PANEL_FX_DIM) v = fxThreeQuarter(v);
+    if (fx & PANEL_FX_SCANLINES) v = fxHalf(v);
+    memcpy(px + i, &v, sizeof(v));
+  }
+  if (i < w) {
+    uint32_t v = px[i];
+    if (fx & PANEL_FX_TINT) v = fxAverage(v, tint);
+    if (fx & PANEL_FX_DIM) v = fxThreeQuarter(v);
+    if (fx & PANEL_FX_SCANLINES) v = fxHalf(v);
+    px[i] = static_cast<uint16_t>(v);
+  }
+}
+
+bool Panel::setLineFx(uint8_t fx) {
+  if (fx == fxFlags) return false;
+  fxFlags = fx;
+  return true;
+}
+
+void Panel::pushLine(int16_t x, int16_t y, uint16_t *pixels, int16_t w) {
+  if (w <= 0) return;
+  uint8_t fx = fxFlags;
+  if (y % UI_SCANLINE_SPACING != 0) fx &= ~PANEL_FX_SCANLINES;
+  if (fx) {
+    uint32_t start = ESP.getCycleCount();
+    applyLineFx(pixels, w, fx);
+    fxStats.cycles += ESP.getCycleCount() - start;
+    fxStats.lines++;
+    fxStats.pixels += w;
+  }
+  uint16_t *src = pixels;
+  if (!redirecting() || y < saveRect.y || y >= saveRect.y + saveRect.h) {
+    if (redirecting() && saveState == SaveState::Capturing) return;
+    glassBitmap(x, y, src, w, 1);
+    return;
+  }
+
+  int16_t ix0 = max<int16_t>(x, saveRect.x);
+  int16_t ix1 = min<int16_t>(x + w, saveRect.x + saveRect.w);
+  if (ix0 < ix1) {
+    memcpy(saveBuf + (y - saveRect.y) * saveRect.w + (ix0 - saveRect.x), src + (ix0 - x), (ix1 - ix0) * sizeof(uint16_t));
+  } else {
+    ix0 = ix1 = x + w;
+  }
+  if (saveState == SaveState::Capturing) return;
+  if (ix0 > x) glassBitmap(x, y, src, ix0 - x, 1);
+  if (x + w > ix1) glassBitmap(ix1, y, src + (ix1 - x), x + w - ix1, 1);
+}
+
+bool Panel::saveUnderOpen(const PanelRect &rect) {
+  if (saveState != SaveState::Idle) return false;
+  int16_t x0 = max<int16_t>(0, rect.x);
+  int16_t y0 = max<int16_t>(0, rect.y);
+  int16_t x1 = min<int16_t>(width(), rect.x + rect.w);
+  int16_t y1 = min<int16_t>(height(), rect.y + rect.h);
+  if (x0 >= x1 || y0 >= y1) return false;
+
+  size_t bytes = static_cast<size_t>(x1 - x0) * (y1 - y0) * sizeof(uint16_t);
+  saveBuf = static_cast<uint16_t *>(uiArenaAlloc(bytes));
+  if (!saveBuf) return false;
+  saveRect = {x0, y0, static_cast<int16_t>(x1 - x0), static_cast<int16_t>(y1 - y0)};
+  saveState = SaveState::Capturing;
+  overlayPass = false;
+  return true;
+}
+
+void Panel::saveUnderCommit() {
+  if (saveState == SaveState::Capturing) saveState = SaveState::Covered;
+}
+
+void Panel::saveUnderClose() {
+  if (saveState == SaveState::Idle) return;
+  saveState = SaveState::Idle;
+  overlayPass = false;
+  glassBitmap(saveRect.x, saveRect.y, saveBuf, saveRect.w, saveRect.h);
+  uiArenaRelease(saveBuf);
+  saveBuf = nullptr;
+}
+
+void Panel::saveUnderDiscard() {
+  if (saveState == SaveState::Idle) return;
+  saveState = SaveState::Idle;
+  overlayPass = false;
+  uiArenaRelease(saveBuf);
+  saveBuf = nullptr;
+}
+
+void Panel::setPower(PanelPower mode) {
+  if (mode == powerMode) return;
+  if (powerMode == PanelPower::Sleep) {
+    sendCommand(CMD_SLPOUT);
+    glassBytes++;
+  }
+  if (mode == PanelPower::Sleep) {
+    sendCommand(CMD_SLPIN);
+    glassBytes++;
+  } else if ((mode == PanelPower::Idle) != idleMode) {
+    idleMode = (mode == PanelPower::Idle);
+    sendCommand(idleMode ? CMD_IDMON : CMD_IDMOFF);
+    glassBytes++;
+  }
+  powerMode = mode;
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Adafruit_GC9A01A.h>
+#include "config.h"
+
+// CASET + RASET + RAMWR issued ahead of every windowed pixel write.
+static const uint8_t PANEL_WINDOW_OVERHEAD_BYTES = 11;
+
+enum class PanelPower : uint8_t {
+  Normal,
+  Idle,  // IDMON: 8-colour mode, lower panel current
+  Sleep  // SLPIN: panel off, GRAM retained
+};
+
+// Line effects applied by pushLine() before pixels leave the line buffer.
+static const uint8_t PANEL_FX_SCANLINES = 0x01; // 50% every UI_SCANLINE_SPACING rows
+static const uint8_t PANEL_FX_TINT = 0x02;      // 50% blend towards COLOR_WARNING
+static const uint8_t PANEL_FX_DIM = 0x04;       // 75% brightness
+
+struct PanelFxStats {
+  uint32_t lines;
+  uint32_t pixels;
+  uint32_t cycles;
+};
+
+struct PanelRect {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+};
+
+// Fixed UI arena. Allocations are LIFO: release the most recent block first.
+void *uiArenaAlloc(size_t bytes);
+void uiArenaRelease(void *block);
+size_t uiArenaUsed();
+
+// GC9A01A with a single save-under slot. The panel has no MISO line, so the
+// pixels beneath an overlay are captured by recomposing them off-glass:
+// saveUnderOpen() routes every draw inside the rect into an arena buffer and
+// drops draws outside it until saveUnderCommit(). While the overlay is up,
+// draws beneath it keep landing in the buffer; draws made between
+// overlayBegin()/overlayEnd() reach the glass. saveUnderClose() restores the
+// buffer with one windowed write; saveUnderDiscard() drops it when the screen
+// is about to be repainted anyway.
+class Panel : public Adafruit_GC9A01A {
+ public:
+  Panel(int8_t cs, int8_t dc, int8_t mosi, int8_t sck, int8_t rst);
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void writePixel(int16_t x, int16_t y, uint16_t color) override;
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+  void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+  void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+
+  // Blit path: one row of RGB565 pixels, honouring the save-under slot. Line
+  // effects are applied to `pixels` in place, so the caller's buffer is consumed.
+  void pushLine(int16_t x, int16_t y, uint16_t *pixels, int16_t w);
+
+  // Returns true when the effect set changed (pixels already on glass are stale).
+  bool setLineFx(uint8_t fx);
+  uint8_t lineFx() const { return fxFlags; }
+  const PanelFxStats &lineFxStats() const { return fxStats; }
+
+  bool saveUnderOpen(const PanelRect &rect);
+  void saveUnderCommit();
+  void saveUnderClose();
+  void saveUnderDiscard();
+  bool saveUnderActive() const { return saveState != SaveState::Idle; }
+  void overlayBegin() { overlayPass = true; }
+  void overlayEnd() { overlayPass = false; }
+
+  // Bytes clocked out to the controller since boot (pixels plus window setup).
+  uint32_t bytesSent() const { return glassBytes; }
+
+  // Controller power state. GRAM survives SLPIN, so waking needs no redraw.
+  void setPower(PanelPower mode);
+  PanelPower power() const { return powerMode; }
+
+ private:
+  enum class SaveState : uint8_t {
+    Idle,
+    Capturing,
+    Covered
+  };
+
+  bool redirecting() const { return saveState != SaveState::Idle && !overlayPass; }
+  void fillSaved(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color);
+  void fillRouted(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, bool inWrite);
+  void glassFill(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color, bool inWrite);
+  void glassBitmap(int16_t x, int16_t y, uint16_t *pixels, int16_t w, int16_t h);
+
+  PanelRect saveRect{0, 0, 0, 0};
+  uint16_t *saveBuf = nullptr;
+  SaveState saveState = SaveState::Idle;
+  bool overlayPass = false;
+  uint32_t glassBytes = 0;
+  PanelPower powerMode = PanelPower::Normal;
+  bool idleMode = false;
+  uint8_t fxFlags = 0;
+  PanelFxStats fxStats{0, 0, 0};
+};
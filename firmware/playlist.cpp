@@ -0,0 +1,317 @@
+#include "playlist.h"
+
+#include <Preferences.h>
+#include <stddef.h>
+
+#include "library.h"
+#include "smartshuffle.h"
+#include "trackstats.h"
+
+static const uint8_t SAVED_VERSION = 1;
+
+struct SavedList {
+  uint8_t version;
+  uint8_t count;
+  TrackLocation entries[PLAYLIST_CAPACITY]; // only `count` are stored
+};
+
+struct PlaylistStats {
+  uint32_t fromQueue; // tracks played off the up-next deque
+  uint32_t missing;   // entries skipped because their file is gone
+  uint16_t saves;
+  uint16_t loads;
+};
+
+static Preferences prefs;
+
+// Up-next deque: ring of queueCount entries starting at queueHead.
+static TrackLocation queue[PLAYLIST_QUEUE_LEN];
+static uint8_t queueHead = 0;
+static uint8_t queueCount = 0;
+
+static TrackLocation list[PLAYLIST_CAPACITY];
+static uint8_t listCount = 0;
+static uint8_t cursor = 0;      // list position playing while listActive
+static bool listActive = false;
+
+static uint16_t position = 1;   // library order: the track the source is on
+static ShuffleMode shuffleMode = ShuffleMode::Off;
+static bool shuffleOn = false;  // any mode
+static bool smartOn = false;    // library order drawn by smartshuffle.cpp
+static bool fromQueue = false;  // the current track came off the deque
+static PlaylistStats stats{};
+
+static uint16_t resolve(const TrackLocation &ref) {
+  return libraryTrackOf(ref);
+}
+
+// Track the source would call current, ignoring the deque.
+static uint16_t sourceTrack() {
+  if (listActive) return resolve(list[cursor]);
+  if (smartOn) return smartShuffleCurrent();
+  return shuffleOn ? shuffleCurrent() : position;
+}
+
+static uint8_t trackWeight(uint16_t track) {
+  return smartShuffleWeight(statsGet(libraryLocate(track)));
+}
+
+static void beginShuffle(uint16_t current) {
+  smartOn = false;
+  if (!libraryReady()) return;
+  if (listActive) {
+    shuffleBegin(listCount, cursor + 1, esp_random());
+    return;
+  }
+  if (shuffleMode == ShuffleMode::Smart) {
+    smartOn = smartShuffleBegin(libraryTotal(), current, esp_random(), trackWeight);
+  }
+  if (!smartOn) shuffleBegin(libraryTotal(), current, esp_random());
+}
+
+static void leaveList(uint16_t current) {
+  bool wasActive = listActive;
+  listActive = false;
+  fromQueue = false;
+  position = current > 0 ? current : 1;
+  if (wasActive && shuffleOn) beginShuffle(position);
+}
+
+static bool stepList(bool forward, bool wrap, uint16_t &track) {
+  // Bounded so a list of files that are all gone cannot spin.
+  for (uint8_t tries = 0; tries < listCount; ++tries) {
+    uint8_t c;
+    if (shuffleOn) {
+      if (forward && !wrap && shuffleAtEpochEnd()) return false;
+      c = (forward ? shuffleNext() : shufflePrev()) - 1;
+    } else if (forward) {
+      if (cursor + 1 >= listCount && !wrap) return false;
+      c = cursor + 1 >= listCount ? 0 : cursor + 1;
+    } else {
+      if (cursor == 0) return false;
+      c = cursor - 1;
+    }
+    cursor = c;
+    uint16_t t = resolve(list[c]);
+    if (t) {
+      track = t;
+      return true;
+    }
+    stats.missing++;
+  }
+  return false;
+}
+
+void playlistBegin() {
+  prefs.begin("playlist", false);
+}
+
+void playlistSync(uint16_t current) {
+  if (!listActive) position = current;
+  if (shuffleOn) beginShuffle(current);
+}
+
+void playlistSetShuffle(ShuffleMode mode, uint16_t current) {
+  if (mode == shuffleMode) return;
+  shuffleMode = mode;
+  shuffleOn = mode != ShuffleMode::Off;
+  if (shuffleOn) {
+    beginShuffle(current);
+  } else {
+    smartOn = false;
+    if (!listActive) position = current;
+  }
+}
+
+ShuffleMode playlistShuffleMode() {
+  return shuffleMode;
+}
+
+bool playlistShuffle() {
+  return shuffleOn;
+}
+
+bool playlistRestoreShuffle(const ShuffleState &state, uint16_t current) {
+  if (shuffleMode != ShuffleMode::Plain || listActive) return false;
+  if (!shuffleRestore(libraryTotal(), state) || shuffleCurrent() != current) return false;
+  position = current;
+  return true;
+}
+
+ShuffleState playlistShuffleState() {
+  return shuffleOn && !smartOn ? shuffleState() : ShuffleState{};
+}
+
+bool playlistNext(bool wrap, uint16_t &track) {
+  while (queueCount > 0) {
+    TrackLocation ref = queue[queueHead];
+    queueHead = (queueHead + 1) % PLAYLIST_QUEUE_LEN;
+    queueCount--;
+    uint16_t t = resolve(ref);
+    if (t) {
+      fromQueue = true;
+      stats.fromQueue++;
+      track = t;
+      return true;
+    }
+    stats.missing++;
+  }
+
+  if (listActive) {
+    if (!stepList(true, wrap, track)) return false;
+  } else if (smartOn) {
+    track = smartShuffleNext(); // never runs out, so `wrap` does not matter
+  } else if (shuffleOn) {
+    if (!wrap && shuffleAtEpochEnd()) return false;
+    track = shuffleNext();
+  } else {
+    uint16_t total = libraryTotal();
+    if (position >= total && !wrap) return false;
+    position = position >= total ? 1 : position + 1;
+    track = position;
+  }
+  fromQueue = false;
+  return true;
+}
+
+bool playlistPrev(uint16_t &track) {
+  if (fromQueue) {
+    // Back from a queued track lands where the source left off.
+    fromQueue = false;
+    track = sourceTrack();
+    if (track) return true;
+  }
+  if (listActive) return stepList(false, false, track);
+  if (smartOn) {
+    track = smartShufflePrev();
+    return true;
+  }
+  if (shuffleOn) {
+    track = shufflePrev();
+    return true;
+  }
+  if (position <= 1) return false;
+  track = --position;
+  return true;
+}
+
+void playlistJump(uint16_t track) {
+  leaveList(track);
+}
+
+bool playlistPlayNext(uint16_t track) {
+  if (track == 0 || !libraryReady()) return false;
+  if (queueCount == PLAYLIST_QUEUE_LEN) queueCount--; // full: the last queued entry gives way
+  queueHead = (queueHead + PLAYLIST_QUEUE_LEN - 1) % PLAYLIST_QUEUE_LEN;
+  queue[queueHead] = libraryLocate(track);
+  queueCount++;
+  return true;
+}
+
+bool playlistEnqueue(uint16_t track) {
+  if (track == 0 || !libraryReady() || queueCount == PLAYLIST_QUEUE_LEN) return false;
+  queue[(queueHead + queueCount) % PLAYLIST_QUEUE_LEN] = libraryLocate(track);
+  queueCount++;
+  return true;
+}
+
+bool playlistAppend(uint16_t track) {
+  if (track == 0 || !libraryReady() || listCount == PLAYLIST_CAPACITY) return false;
+  list[listCount++] = libraryLocate(track);
+  // A running list shuffle covers the positions it was started with; the
+  // new entry joins the order at the next reshuffle.
+  return true;
+}
+
+void playlistClear() {
+  if (listActive) leaveList(resolve(list[cursor]));
+  listCount = 0;
+  cursor = 0;
+}
+
+bool playlistStart(uint16_t &first) {
+  if (listCount == 0) return false;
+  listActive = true;
+  fromQueue = false;
+  cursor = 0;
+  smartOn = false;
+  if (shuffleOn) shuffleBegin(listCount, 1, esp_random());
+  first = resolve(list[0]);
+  if (first) return true;
+  stats.missing++;
+  if (stepList(true, false, first)) return true;
+  leaveList(position);
+  return false;
+}
+
+static void slotKey(char *key, uint8_t slot) {
+  snprintf(key, 8, "list%u", slot);
+}
+
+bool playlistSave(uint8_t slot) {
+  if (slot >= PLAYLIST_SLOTS) return false;
+  SavedList saved;
+  saved.version = SAVED_VERSION;
+  saved.count = listCount;
+  memcpy(saved.entries, list, listCount * sizeof(TrackLocation));
+  char key[8];
+  slotKey(key, slot);
+  size_t len = offsetof(SavedList, entries) + listCount * sizeof(TrackLocation);
+  if (prefs.putBytes(key, &saved, len) != len) return false;
+  stats.saves++;
+  return true;
+}
+
+bool playlistLoad(uint8_t slot) {
+  if (slot >= PLAYLIST_SLOTS) return false;
+  SavedList saved;
+  char key[8];
+  slotKey(key, slot);
+  size_t len = prefs.getBytes(key, &saved, sizeof(saved));
+  if (len < offsetof(SavedList, entries) || saved.version != SAVED_VERSION || saved.count > PLAYLIST_CAPACITY ||
+      len != offsetof(SavedList, entries) + saved.count * sizeof(TrackLocation)) {
+    return false;
+  }
+  if (listActive) leaveList(resolve(list[cursor]));
+  memcpy(list, saved.entries, saved.count * sizeof(TrackLocation));
+  listCount = saved.count;
+  cursor = 0;
+  stats.loads++;
+  return true;
+}
+
+bool playlistActive() {
+  return listActive;
+}
+
+void playlistPrintStats(Print &out) {
+  out.print("playlist source=");
+  if (listActive) {
+    out.print("list ");
+    out.print(cursor + 1);
+    out.print("/");
+    out.print(listCount);
+  } else {
+    out.print("library");
+  }
+  out.print(" list=");
+  out.print(listCount);
+  out.print(" upNext=");
+  out.print(queueCount);
+  static const char *const SHUFFLE_NAMES[] = {"off", "on", "smart"};
+  out.print(" shuffle=");
+  out.print(SHUFFLE_NAMES[static_cast<uint8_t>(shuffleMode)]);
+  out.print(" saved=");
+  for (uint8_t slot = 0; slot < PLAYLIST_SLOTS; ++slot) {
+    char key[8];
+    slotKey(key, slot);
+    size_t len = prefs.getBytesLength(key);
+    if (slot) out.print(",");
+    out.print(len >= offsetof(SavedList, entries) ? (len - offsetof(SavedList, entries)) / sizeof(TrackLocation) : 0);
+  }
+  out.print(" fromQueue=");
+  out.print(stats.fromQueue);
+  out.print(" missing=");
+  out.println(stats.missing);
+  if (smartOn) smartShufflePrintStats(out);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "shuffle.h"
+
+enum class ShuffleMode : uint8_t {
+  Off,
+  Plain, // shuffle.h: every track once per round
+  Smart  // smartshuffle.h: weighted by play/skip history; a list shuffles plainly
+};
+
+// Play order. Everything that decides which track comes after which lives
+// here, and audioNext()/audioPrev() and the end-of-track policy only ask:
+//
+//  - an up-next deque (ring of PLAYLIST_QUEUE_LEN) is drained first; "play
+//    next" pushes to its front, "queue" to its back;
+//  - then the source: the whole library in track order, or the working list
+//    (up to PLAYLIST_CAPACITY entries) once it is started. Either can be
+//    shuffled; a list shuffles over its positions. Smart shuffle draws the
+//    library by play/skip history, and falls back to plain shuffle above
+//    SMART_SHUFFLE_MAX_TRACKS tracks.
+//
+// Entries are file references (folder/file) resolved through the library
+// when they come up, so a saved list survives a rescan and entries whose file
+// is gone are skipped. Lists are saved to and loaded from PLAYLIST_SLOTS NVS
+// slots. Everything except save/load is O(1) and nothing allocates.
+void playlistBegin();
+// Library became ready or changed; `current` is the track now playing.
+void playlistSync(uint16_t current);
+// Takes effect once the library is ready (playlistSync) if it is not yet.
+void playlistSetShuffle(ShuffleMode mode, uint16_t current);
+ShuffleMode playlistShuffleMode();
+bool playlistShuffle(); // any mode but Off
+// Only a plain shuffle is restored; a smart one starts over from `current`.
+bool playlistRestoreShuffle(const ShuffleState &state, uint16_t current);
+ShuffleState playlistShuffleState();
+
+// false: nothing comes next (end of the order without `wrap`). The state only
+// moves when a track is returned.
+bool playlistNext(bool wrap, uint16_t &track);
+bool playlistPrev(uint16_t &track);
+// A track picked outside the order (album skip, direct play): leaves the list
+// and continues the library order from there.
+void playlistJump(uint16_t track);
+
+bool playlistPlayNext(uint16_t track);
+bool playlistEnqueue(uint16_t track);
+bool playlistAppend(uint16_t track);
+void playlistClear();
+// Starts the working list from its first playable entry.
+bool playlistStart(uint16_t &first);
+bool playlistSave(uint8_t slot);
+bool playlistLoad(uint8_t slot); // replaces the working list, does not start it
+bool playlistActive();
+void playlistPrintStats(Print &out);
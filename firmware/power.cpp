@@ -1,5 +1,7 @@
 #include "power.h"
 
+#include <esp_sleep.h>
+
 void powerInit() {
   analogReadResolution(12);
 }
@@ -29,3 +31,12 @@ BatteryStatus readBattery() {
   return status;
 }
 
+uint32_t powerLightSleep() {
+  // RAM, the UART configuration and the paused DFPlayer all survive light
+  // sleep, so playback can carry on where it stopped. Wake sources are armed
+  // by the caller (inputArmWake).
+  esp_sleep_enable_gpio_wakeup();
+  unsigned long before = millis();
+  esp_light_sleep_start();
+  return millis() - before;
+}
@@ -17,4 +17,5 @@ struct BatteryStatus {
 
 void powerInit();
 BatteryStatus readBattery();
-
+// Light-sleeps the CPU until a GPIO wake source fires; returns the ms slept.
+uint32_t powerLightSleep();
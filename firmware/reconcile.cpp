@@ -0,0 +1,70 @@
+#include "reconcile.h"
+
+struct ReconcileStats {
+  uint32_t rounds;
+  uint32_t clean;
+  uint32_t voided;
+  uint32_t mismatches[3]; // by ReconcileField
+};
+
+static uint32_t intervalMs = RECONCILE_MIN_MS;
+static unsigned long dueAt = RECONCILE_MIN_MS;
+static bool roundOpen = false;
+static ReconcileStats stats{};
+
+void reconcileSoon(unsigned long now) {
+  intervalMs = RECONCILE_MIN_MS;
+  dueAt = now + intervalMs;
+}
+
+bool reconcileDue(unsigned long now) {
+  return !roundOpen && static_cast<long>(now - dueAt) >= 0;
+}
+
+uint32_t reconcileIntervalMs() {
+  return intervalMs;
+}
+
+void reconcileStarted() {
+  roundOpen = true;
+  stats.rounds++;
+}
+
+void reconcileMismatch(ReconcileField field) {
+  stats.mismatches[static_cast<uint8_t>(field)]++;
+}
+
+void reconcileFinished(bool clean, unsigned long now) {
+  roundOpen = false;
+  if (clean) {
+    stats.clean++;
+    intervalMs = min<uint32_t>(intervalMs * 2, RECONCILE_MAX_MS);
+  } else {
+    intervalMs = RECONCILE_MIN_MS;
+  }
+  dueAt = now + intervalMs;
+}
+
+void reconcileVoided(unsigned long now) {
+  roundOpen = false;
+  stats.voided++;
+  dueAt = now + RECONCILE_MIN_MS;
+}
+
+void reconcilePrintStats(Print &out) {
+  out.print("reconcile rounds=");
+  out.print(stats.rounds);
+  out.print(" clean=");
+  out.print(stats.clean);
+  out.print(" voided=");
+  out.print(stats.voided);
+  out.print(" mismatch status=");
+  out.print(stats.mismatches[static_cast<uint8_t>(ReconcileField::Status)]);
+  out.print(" volume=");
+  out.print(stats.mismatches[static_cast<uint8_t>(ReconcileField::Volume)]);
+  out.print(" track=");
+  out.print(stats.mismatches[static_cast<uint8_t>(ReconcileField::Track)]);
+  out.print(" interval=");
+  out.print(intervalMs);
+  out.println("ms");
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// When to check the local playback model (state, volume, track) against the
+// module, and what the checks found. audio.cpp queues a round of queries
+// (0x4C, 0x42, 0x43) back to back once the link is idle, so they follow each
+// other on the wire without waiting for the loop; the replies are compared
+// as they come in and anything that differs is put right.
+//
+// The interval adapts: a command that changes playback brings the next round
+// to RECONCILE_MIN_MS, each round that matches doubles it up to
+// RECONCILE_MAX_MS, and a mismatch starts over from the minimum. A round
+// also serves as the health check, and no separate ping goes out in between,
+// so a settled player costs three short queries every couple of minutes.
+enum class ReconcileField : uint8_t {
+  Status,
+  Volume,
+  Track
+};
+
+// Playback changed on purpose: check again soon.
+void reconcileSoon(unsigned long now);
+bool reconcileDue(unsigned long now);
+uint32_t reconcileIntervalMs();
+void reconcileStarted();
+void reconcileMismatch(ReconcileField field);
+// All replies of a round are in; `clean` if nothing needed correcting.
+void reconcileFinished(bool clean, unsigned long now);
+// Something was queued, or a query went unanswered, before the round ended.
+void reconcileVoided(unsigned long now);
+void reconcilePrintStats(Print &out);
@@ -0,0 +1,94 @@
+#include "resume.h"
+
+#include <Preferences.h>
+
+static const uint8_t RESUME_VERSION = 1;
+
+struct ResumeStats {
+  uint32_t changes;     // distinct states seen; a write-through store would commit each
+  uint32_t commits;
+  uint32_t checkpoints; // commits caused only by elapsed time
+  uint32_t flushes;
+  uint32_t identical;   // commits skipped because NVS already held the blob
+};
+
+static Preferences prefs;
+static bool loaded = false;
+static ResumeState saved{};   // what NVS holds
+static ResumeState pending{}; // latest state from the caller
+static bool dirty = false;
+static unsigned long changedAt = 0;
+static unsigned long committedAt = 0;
+static ResumeStats stats{};
+
+// Everything but elapsed time, which moves on every call while playing.
+static bool sameSettings(const ResumeState &a, const ResumeState &b) {
+  return a.folder == b.folder && a.track == b.track && a.volume == b.volume && a.uiMode == b.uiMode &&
+         a.endPolicy == b.endPolicy && a.shuffleOn == b.shuffleOn && a.shuffle.seed == b.shuffle.seed &&
+         a.shuffle.start == b.shuffle.start && a.shuffle.cursor == b.shuffle.cursor;
+}
+
+static bool commit(unsigned long now) {
+  committedAt = now;
+  dirty = false;
+  if (sameSettings(pending, saved) && pending.elapsedMs == saved.elapsedMs) {
+    stats.identical++;
+    return false;
+  }
+  pending.version = RESUME_VERSION;
+  prefs.putBytes("state", &pending, sizeof(pending));
+  saved = pending;
+  stats.commits++;
+  return true;
+}
+
+void resumeBegin() {
+  prefs.begin("resume", false);
+  loaded = prefs.getBytes("state", &saved, sizeof(saved)) == sizeof(saved) && saved.version == RESUME_VERSION &&
+           saved.track >= 1 && saved.volume <= MAX_VOLUME &&
+           saved.endPolicy <= static_cast<uint8_t>(EndOfTrack::RepeatOne);
+  if (!loaded) saved = ResumeState{};
+  pending = saved;
+}
+
+bool resumeLoad(ResumeState &out) {
+  if (!loaded) return false;
+  out = saved;
+  return true;
+}
+
+void resumeUpdate(const ResumeState &state, bool playing, unsigned long now) {
+  if (!sameSettings(state, pending)) {
+    stats.changes++;
+    dirty = true;
+    changedAt = now;
+  }
+  pending = state;
+
+  if (dirty) {
+    if (now - changedAt >= RESUME_SETTLE_MS) commit(now);
+  } else if (playing && now - committedAt >= RESUME_CHECKPOINT_MS) {
+    if (commit(now)) stats.checkpoints++;
+  }
+}
+
+void resumeFlush(unsigned long now) {
+  stats.flushes++;
+  commit(now);
+}
+
+void resumePrintStats(Print &out) {
+  out.print("resume changes=");
+  out.print(stats.changes);
+  out.print(" commits=");
+  out.print(stats.commits);
+  out.print(" (checkpoints=");
+  out.print(stats.checkpoints);
+  out.print(" flushes=");
+  out.print(stats.flushes);
+  out.print(") skippedIdentical=");
+  out.print(stats.identical);
+  uint32_t settingCommits = stats.commits - stats.checkpoints;
+  out.print(" writesSaved=");
+  out.println(stats.changes > settingCommits ? stats.changes - settingCommits : 0);
+}
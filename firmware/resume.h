@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "shuffle.h"
+
+// Playback state restored at boot. Kept in NVS as one blob; writes are
+// deferred until the state has been stable for RESUME_SETTLE_MS, with an
+// elapsed-time checkpoint every RESUME_CHECKPOINT_MS while playing and an
+// immediate flush on low battery. Identical blobs are never rewritten.
+struct ResumeState {
+  uint8_t version;
+  uint8_t folder;     // 0 = /mp3
+  uint16_t track;
+  uint8_t volume;
+  uint8_t uiMode;     // UIMode as stored by SPECTRA.ino
+  uint8_t endPolicy;  // EndOfTrack
+  uint8_t shuffleOn;  // ShuffleMode
+  ShuffleState shuffle;
+  uint32_t elapsedMs; // approximate; the DFPlayer cannot seek, tracks restart
+};
+
+void resumeBegin();
+bool resumeLoad(ResumeState &out);
+void resumeUpdate(const ResumeState &state, bool playing, unsigned long now);
+void resumeFlush(unsigned long now);
+void resumePrintStats(Print &out);
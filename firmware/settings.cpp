@@ -0,0 +1,167 @@
+#include "settings.h"
+
+#include <Preferences.h>
+#include "sleeptimer.h"
+
+static const uint8_t SETTINGS_VERSION = 1;
+
+struct SavedSettings {
+  uint8_t version;
+  AudioSettings audio;
+};
+
+struct SettingsStats {
+  uint32_t edits;
+  uint16_t writes;
+  uint16_t identical; // saves skipped because NVS already held the blob
+};
+
+static const char *const EQ_NAMES[EQ_PRESET_COUNT] = {"NORMAL", "POP", "ROCK", "JAZZ", "CLASSIC", "BASS"};
+static const char *const OUTPUT_NAMES[OUTPUT_PROFILE_COUNT] = {"SPEAKER", "PHONES"};
+static const char *const FIELD_NAMES[SETTINGS_FIELD_COUNT] = {"EQ", "OUT", "MAX", "START", "SLEEP"};
+
+static Preferences prefs;
+static AudioSettings current = {
+  EqPreset::Normal, OutputProfile::Speaker, {MAX_VOLUME, SETTINGS_HEADPHONE_MAX_VOLUME}, {0, 0}};
+static AudioSettings saved = current; // what NVS holds
+static SettingsStats stats{};
+
+static bool valid(const AudioSettings &s) {
+  if (static_cast<uint8_t>(s.eq) >= EQ_PRESET_COUNT || static_cast<uint8_t>(s.output) >= OUTPUT_PROFILE_COUNT) {
+    return false;
+  }
+  for (uint8_t i = 0; i < OUTPUT_PROFILE_COUNT; ++i) {
+    if (s.maxVolume[i] == 0 || s.maxVolume[i] > MAX_VOLUME || s.startVolume[i] > s.maxVolume[i]) return false;
+  }
+  return true;
+}
+
+static uint8_t cycle(uint8_t value, int8_t delta, uint8_t count) {
+  return static_cast<uint8_t>((value + count + delta % count) % count);
+}
+
+static bool stepVolume(uint8_t &value, int8_t delta, uint8_t lo, uint8_t hi) {
+  int16_t next = constrain(value + delta, lo, hi);
+  if (next == value) return false;
+  value = next;
+  return true;
+}
+
+void settingsBegin() {
+  prefs.begin("settings", false);
+  SavedSettings blob;
+  if (prefs.getBytes("audio", &blob, sizeof(blob)) == sizeof(blob) && blob.version == SETTINGS_VERSION &&
+      valid(blob.audio)) {
+    current = blob.audio;
+  }
+  saved = current;
+}
+
+const AudioSettings &settingsGet() {
+  return current;
+}
+
+bool settingsStep(SettingsField field, int8_t delta) {
+  uint8_t out = static_cast<uint8_t>(current.output);
+  bool changed = true;
+  switch (field) {
+    case SettingsField::Eq:
+      current.eq = static_cast<EqPreset>(cycle(static_cast<uint8_t>(current.eq), delta, EQ_PRESET_COUNT));
+      break;
+    case SettingsField::Output:
+      current.output = static_cast<OutputProfile>(cycle(out, delta, OUTPUT_PROFILE_COUNT));
+      break;
+    case SettingsField::MaxVolume:
+      changed = stepVolume(current.maxVolume[out], delta, 1, MAX_VOLUME);
+      // A lower limit drags the startup volume down with it.
+      if (current.startVolume[out] > current.maxVolume[out]) current.startVolume[out] = current.maxVolume[out];
+      break;
+    case SettingsField::StartVolume:
+      changed = stepVolume(current.startVolume[out], delta, 0, current.maxVolume[out]);
+      break;
+    case SettingsField::SleepTimer:
+      sleepTimerStep(delta);
+      return false; // nothing for audio.cpp to apply
+  }
+  if (changed) stats.edits++;
+  return changed;
+}
+
+bool settingsSetEq(uint8_t preset) {
+  if (preset >= EQ_PRESET_COUNT) return false;
+  current.eq = static_cast<EqPreset>(preset);
+  stats.edits++;
+  return true;
+}
+
+uint8_t settingsVolumeCap() {
+  return current.maxVolume[static_cast<uint8_t>(current.output)];
+}
+
+uint8_t settingsStartVolume() {
+  return current.startVolume[static_cast<uint8_t>(current.output)];
+}
+
+const char *settingsFieldName(SettingsField field) {
+  return FIELD_NAMES[static_cast<uint8_t>(field)];
+}
+
+void settingsFormatValue(SettingsField field, char *buf, size_t len) {
+  uint8_t out = static_cast<uint8_t>(current.output);
+  switch (field) {
+    case SettingsField::Eq:
+      snprintf(buf, len, "%s", EQ_NAMES[static_cast<uint8_t>(current.eq)]);
+      break;
+    case SettingsField::Output:
+      snprintf(buf, len, "%s", OUTPUT_NAMES[out]);
+      break;
+    case SettingsField::MaxVolume:
+      snprintf(buf, len, "VOL %u", current.maxVolume[out]);
+      break;
+    case SettingsField::StartVolume:
+      if (current.startVolume[out] == 0) {
+        snprintf(buf, len, "LAST");
+      } else {
+        snprintf(buf, len, "VOL %u", current.startVolume[out]);
+      }
+      break;
+    case SettingsField::SleepTimer:
+      sleepTimerFormat(buf, len);
+      break;
+  }
+}
+
+bool settingsSave() {
+  if (memcmp(&current, &saved, sizeof(current)) == 0) {
+    stats.identical++;
+    return false;
+  }
+  SavedSettings blob;
+  blob.version = SETTINGS_VERSION;
+  blob.audio = current;
+  prefs.putBytes("audio", &blob, sizeof(blob));
+  saved = current;
+  stats.writes++;
+  return true;
+}
+
+void settingsPrintStats(Print &out) {
+  out.print("settings eq=");
+  out.print(EQ_NAMES[static_cast<uint8_t>(current.eq)]);
+  out.print(" out=");
+  out.print(OUTPUT_NAMES[static_cast<uint8_t>(current.output)]);
+  for (uint8_t i = 0; i < OUTPUT_PROFILE_COUNT; ++i) {
+    out.print(' ');
+    out.print(OUTPUT_NAMES[i]);
+    out.print(" max=");
+    out.print(current.maxVolume[i]);
+    out.print(" start=");
+    out.print(current.startVolume[i]);
+  }
+  out.print(" edits=");
+  out.print(stats.edits);
+  out.print(" writes=");
+  out.print(stats.writes);
+  out.print(" identical=");
+  out.println(stats.identical);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// DFPlayer EQ presets, in SetEq parameter order.
+enum class EqPreset : uint8_t {
+  Normal,
+  Pop,
+  Rock,
+  Jazz,
+  Classic,
+  Bass
+};
+static const uint8_t EQ_PRESET_COUNT = 6;
+
+// Where the audio is listened to. The module drives its speaker amplifier and
+// DAC pins at the same time and has no output switch, so the profile selects
+// which volume limit and startup volume apply.
+enum class OutputProfile : uint8_t {
+  Speaker,
+  Headphones
+};
+static const uint8_t OUTPUT_PROFILE_COUNT = 2;
+
+struct AudioSettings {
+  EqPreset eq;
+  OutputProfile output;
+  uint8_t maxVolume[OUTPUT_PROFILE_COUNT];
+  uint8_t startVolume[OUTPUT_PROFILE_COUNT]; // 0 = keep the resumed volume
+};
+
+// Fields of the on-screen selector, in the order Play steps through them.
+enum class SettingsField : uint8_t {
+  Eq,
+  Output,
+  MaxVolume,
+  StartVolume,
+  SleepTimer // not stored; steps sleeptimer.h
+};
+static const uint8_t SETTINGS_FIELD_COUNT = 5;
+
+// Audio settings, kept in NVS as one blob. Edits only change the model:
+// audio.cpp applies them through the command queue (audioSettingsChanged) and
+// settingsSave() writes NVS once, when editing ends. The limits of the
+// selected output are the ones the step functions and caps refer to.
+void settingsBegin();
+const AudioSettings &settingsGet();
+// EQ and output cycle; volumes stop at their limits (returns false there).
+bool settingsStep(SettingsField field, int8_t delta);
+bool settingsSetEq(uint8_t preset);
+uint8_t settingsVolumeCap();
+uint8_t settingsStartVolume();
+const char *settingsFieldName(SettingsField field);
+void settingsFormatValue(SettingsField field, char *buf, size_t len);
+bool settingsSave(); // false when NVS already held these settings
+void settingsPrintStats(Print &out);
@@ -0,0 +1,157 @@
+#include "shuffle.h"
+
+static const uint8_t FEISTEL_ROUNDS = 4;
+
+static uint16_t trackCount = 0;
+static uint8_t halfBits = 1;
+static uint32_t halfMask = 1;
+static uint32_t roundKeys[FEISTEL_ROUNDS];
+static ShuffleState state{};
+
+static uint16_t history[SHUFFLE_HISTORY_LEN];
+static uint8_t historyHead = 0;
+static uint8_t historyCount = 0;
+
+static uint32_t splitmix32(uint32_t &x) {
+  uint32_t z = (x += 0x9E3779B9u);
+  z = (z ^ (z >> 16)) * 0x85EBCA6Bu;
+  z = (z ^ (z >> 13)) * 0xC2B2AE35u;
+  return z ^ (z >> 16);
+}
+
+static uint32_t roundFn(uint32_t half, uint32_t key) {
+  uint32_t h = (half ^ key) * 0x9E3779B1u;
+  h ^= h >> 15;
+  h *= 0x85EBCA77u;
+  return (h ^ (h >> 13)) & halfMask;
+}
+
+static uint32_t feistel(uint32_t x) {
+  uint32_t l = x >> halfBits;
+  uint32_t r = x & halfMask;
+  for (uint8_t i = 0; i < FEISTEL_ROUNDS; ++i) {
+    uint32_t t = l ^ roundFn(r, roundKeys[i]);
+    l = r;
+    r = t;
+  }
+  return (l << halfBits) | r;
+}
+
+static uint32_t feistelInverse(uint32_t x) {
+  uint32_t l = x >> halfBits;
+  uint32_t r = x & halfMask;
+  for (int8_t i = FEISTEL_ROUNDS - 1; i >= 0; --i) {
+    uint32_t t = r ^ roundFn(l, roundKeys[i]);
+    r = l;
+    l = t;
+  }
+  return (l << halfBits) | r;
+}
+
+// Permutation of [0, trackCount). Domain is < 4 * trackCount, so the walk
+// takes under four steps on average.
+static uint16_t permute(uint16_t index) {
+  uint32_t x = index;
+  do {
+    x = feistel(x);
+  } while (x >= trackCount);
+  return static_cast<uint16_t>(x);
+}
+
+static uint16_t unpermute(uint16_t value) {
+  uint32_t x = value;
+  do {
+    x = feistelInverse(x);
+  } while (x >= trackCount);
+  return static_cast<uint16_t>(x);
+}
+
+static void keyFromSeed(uint32_t seed) {
+  uint32_t x = seed;
+  for (uint8_t i = 0; i < FEISTEL_ROUNDS; ++i) roundKeys[i] = splitmix32(x);
+}
+
+static void setCount(uint16_t count) {
+  trackCount = count > 0 ? count : 1;
+  uint8_t bits = 2;
+  while ((1UL << bits) < trackCount) bits++;
+  if (bits & 1) bits++;
+  halfBits = bits / 2;
+  halfMask = (1UL << halfBits) - 1;
+}
+
+static void pushHistory(uint16_t track) {
+  history[(historyHead + historyCount) % SHUFFLE_HISTORY_LEN] = track;
+  if (historyCount < SHUFFLE_HISTORY_LEN) {
+    historyCount++;
+  } else {
+    historyHead = (historyHead + 1) % SHUFFLE_HISTORY_LEN;
+  }
+}
+
+void shuffleBegin(uint16_t count, uint16_t firstTrack, uint32_t seed) {
+  setCount(count);
+  keyFromSeed(seed);
+  state.seed = seed;
+  state.cursor = 0;
+  firstTrack = constrain(firstTrack, (uint16_t)1, trackCount);
+  state.start = unpermute(firstTrack - 1);
+  historyHead = historyCount = 0;
+}
+
+bool shuffleRestore(uint16_t count, const ShuffleState &saved) {
+  if (saved.start >= count || saved.cursor >= count) return false;
+  setCount(count);
+  keyFromSeed(saved.seed);
+  state = saved;
+  historyHead = historyCount = 0;
+  return true;
+}
+
+uint16_t shuffleTrackAt(uint16_t position) {
+  uint32_t index = (static_cast<uint32_t>(state.start) + position) % trackCount;
+  return permute(static_cast<uint16_t>(index)) + 1;
+}
+
+uint16_t shuffleCurrent() {
+  return shuffleTrackAt(state.cursor);
+}
+
+bool shuffleAtEpochEnd() {
+  return state.cursor + 1 >= trackCount;
+}
+
+uint16_t shuffleNext() {
+  uint16_t leaving = shuffleCurrent();
+  pushHistory(leaving);
+  if (!shuffleAtEpochEnd()) {
+    state.cursor++;
+    return shuffleCurrent();
+  }
+
+  // New epoch with a fresh key; avoid opening on the track just played.
+  uint32_t seed = state.seed;
+  do {
+    splitmix32(seed);
+    keyFromSeed(seed);
+    state.seed = seed;
+    state.start = static_cast<uint16_t>(seed % trackCount);
+    state.cursor = 0;
+  } while (trackCount > 1 && shuffleCurrent() == leaving);
+  return shuffleCurrent();
+}
+
+uint16_t shufflePrev() {
+  if (historyCount > 0) {
+    historyCount--;
+    uint16_t track = history[(historyHead + historyCount) % SHUFFLE_HISTORY_LEN];
+    if (state.cursor > 0 && shuffleTrackAt(state.cursor - 1) == track) state.cursor--;
+    return track;
+  }
+  if (state.cursor > 0) state.cursor--;
+  return shuffleCurrent();
+}
+
+ShuffleState shuffleState() {
+  return state;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Non-repeating shuffle over tracks 1..count without a track table. Position
+// p of an epoch maps to a track through a keyed 4-round Feistel network over
+// the next even power of two, cycle-walking values >= count back into range,
+// so every track comes up exactly once per epoch and the state is a seed plus
+// a cursor. The epoch is rotated so it starts on the track that was playing
+// when shuffle was switched on. After the last position a new seed is drawn.
+//
+// Prev walks a short ring of tracks left by Next, which also reaches back
+// across epoch boundaries, then falls back to stepping the cursor.
+struct ShuffleState {
+  uint32_t seed;
+  uint16_t start;  // permutation index the epoch begins at
+  uint16_t cursor; // positions played since start
+};
+
+static const uint8_t SHUFFLE_HISTORY_LEN = 16;
+
+void shuffleBegin(uint16_t count, uint16_t firstTrack, uint32_t seed);
+bool shuffleRestore(uint16_t count, const ShuffleState &state);
+uint16_t shuffleCurrent();
+uint16_t shuffleNext();
+uint16_t shufflePrev();
+bool shuffleAtEpochEnd();
+ShuffleState shuffleState();
+uint16_t shuffleTrackAt(uint16_t position);
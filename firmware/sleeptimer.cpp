@@ -0,0 +1,97 @@
+#include "sleeptimer.h"
+
+#include <esp_timer.h>
+
+struct SleepStats {
+  uint32_t armed;
+  uint32_t expired;
+  uint32_t sleeps;
+  uint32_t lastSleptMs;
+};
+
+static esp_timer_handle_t timer = nullptr;
+static volatile bool fired = false;
+static bool armed = false;
+static uint16_t setMinutes = 0;
+static unsigned long armedAt = 0;
+static SleepStats stats{};
+
+static void onExpiry(void *) {
+  fired = true;
+}
+
+void sleepTimerBegin() {
+  esp_timer_create_args_t args{};
+  args.callback = onExpiry;
+  args.name = "sleep";
+  if (esp_timer_create(&args, &timer) != ESP_OK) timer = nullptr;
+}
+
+void sleepTimerSet(uint16_t minutes) {
+  if (!timer) return;
+  if (armed) esp_timer_stop(timer);
+  fired = false;
+  armed = false;
+  setMinutes = min<uint16_t>(minutes, SLEEP_TIMER_MAX_MIN);
+  if (setMinutes == 0) return;
+  armed = esp_timer_start_once(timer, setMinutes * 60000000ULL) == ESP_OK;
+  armedAt = millis();
+  if (armed) stats.armed++;
+}
+
+void sleepTimerStep(int8_t delta) {
+  // From a running timer, step from what is left rather than what was set.
+  int16_t base = armed ? (sleepTimerRemainingMs() + 59999) / 60000 : 0;
+  base = (base + (delta > 0 ? 0 : SLEEP_TIMER_STEP_MIN - 1)) / SLEEP_TIMER_STEP_MIN * SLEEP_TIMER_STEP_MIN;
+  int16_t minutes = base + delta * SLEEP_TIMER_STEP_MIN;
+  if (minutes < 0) minutes = SLEEP_TIMER_MAX_MIN; // down from off wraps to the longest
+  sleepTimerSet(min<int16_t>(minutes, SLEEP_TIMER_MAX_MIN));
+}
+
+bool sleepTimerArmed() {
+  return armed;
+}
+
+uint32_t sleepTimerRemainingMs() {
+  if (!armed) return 0;
+  uint32_t total = setMinutes * 60000UL;
+  uint32_t gone = millis() - armedAt;
+  return gone < total ? total - gone : 0;
+}
+
+bool sleepTimerExpired() {
+  if (!fired) return false;
+  fired = false;
+  armed = false;
+  stats.expired++;
+  return true;
+}
+
+void sleepTimerNoteSlept(uint32_t ms) {
+  stats.sleeps++;
+  stats.lastSleptMs = ms;
+}
+
+void sleepTimerFormat(char *buf, size_t len) {
+  if (!armed) {
+    snprintf(buf, len, "OFF");
+  } else {
+    snprintf(buf, len, "%lum", static_cast<unsigned long>((sleepTimerRemainingMs() + 59999) / 60000));
+  }
+}
+
+void sleepTimerPrintStats(Print &out) {
+  char left[8];
+  sleepTimerFormat(left, sizeof(left));
+  out.print("sleep timer=");
+  out.print(left);
+  out.print(" armed=");
+  out.print(stats.armed);
+  out.print(" expired=");
+  out.print(stats.expired);
+  out.print(" sleeps=");
+  out.print(stats.sleeps);
+  out.print(" lastSlept=");
+  out.print(stats.lastSleptMs / 1000);
+  out.println("s");
+}
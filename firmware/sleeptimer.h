@@ -0,0 +1,23 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+
+// Sleep timer. Arming it starts a one-shot esp_timer; nothing runs per loop
+// while it counts down. The timer callback only raises a flag, which loop()
+// collects with sleepTimerExpired() and turns into the fade-out, pause and
+// light sleep (SPECTRA.ino).
+void sleepTimerBegin();
+// Arms the timer for `minutes` from now; 0 disarms it.
+void sleepTimerSet(uint16_t minutes);
+// Moves the setting by SLEEP_TIMER_STEP_MIN per step, between off and
+// SLEEP_TIMER_MAX_MIN; stepping down from off wraps to the maximum.
+void sleepTimerStep(int8_t delta);
+bool sleepTimerArmed();
+uint32_t sleepTimerRemainingMs();
+// True once per expiry.
+bool sleepTimerExpired();
+// Bookkeeping for `sleep`: how long the last light sleep lasted.
+void sleepTimerNoteSlept(uint32_t ms);
+void sleepTimerFormat(char *buf, size_t len);
+void sleepTimerPrintStats(Print &out);
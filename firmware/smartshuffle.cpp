@@ -0,0 +1,144 @@
+#include "smartshuffle.h"
+
+struct SmartShuffleStats {
+  uint32_t draws;
+  uint32_t replays; // Next retracing tracks Prev walked back over
+  uint16_t builds;
+};
+
+// tree[i] holds the sum of weights over (i - lowbit(i), i]; index = track.
+static uint32_t tree[SMART_SHUFFLE_MAX_TRACKS + 1];
+static uint8_t weights[SMART_SHUFFLE_MAX_TRACKS + 1];
+static uint16_t trackCount = 0;
+static uint16_t topBit = 1; // highest power of two <= trackCount
+static uint32_t totalWeight = 0;
+static SmartWeightFn weightFn = nullptr;
+static uint32_t rng = 1;
+
+// Tracks drawn, oldest first; the newest `window` are held at weight zero.
+static uint16_t recent[SMART_SHUFFLE_RECENT];
+static uint8_t recentHead = 0;
+static uint8_t recentCount = 0;
+static uint8_t window = 0;
+static uint8_t back = 0; // how far Prev has walked back from the newest
+static SmartShuffleStats stats{};
+
+static uint32_t nextRandom() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void setWeight(uint16_t track, uint8_t weight) {
+  int32_t delta = static_cast<int32_t>(weight) - weights[track];
+  if (delta == 0) return;
+  weights[track] = weight;
+  totalWeight += delta;
+  for (uint16_t i = track; i <= trackCount; i += i & -i) tree[i] += delta;
+}
+
+// Smallest track whose prefix sum exceeds r (r < totalWeight).
+static uint16_t findTrack(uint32_t r) {
+  uint16_t pos = 0;
+  for (uint16_t step = topBit; step; step >>= 1) {
+    uint16_t next = pos + step;
+    if (next <= trackCount && tree[next] <= r) {
+      pos = next;
+      r -= tree[next];
+    }
+  }
+  return pos + 1;
+}
+
+static uint16_t recentAt(uint8_t age) {
+  return recent[(recentHead + recentCount - 1 - age) % SMART_SHUFFLE_RECENT];
+}
+
+static void pushRecent(uint16_t track) {
+  // The entry about to age out of the window draws again, at its weight now.
+  uint16_t leaving = window > 0 && recentCount >= window ? recentAt(window - 1) : 0;
+  if (window > 0) setWeight(track, 0);
+  if (leaving) setWeight(leaving, weightFn(leaving));
+
+  recent[(recentHead + recentCount) % SMART_SHUFFLE_RECENT] = track;
+  if (recentCount < SMART_SHUFFLE_RECENT) {
+    recentCount++;
+  } else {
+    recentHead = (recentHead + 1) % SMART_SHUFFLE_RECENT;
+  }
+}
+
+bool smartShuffleBegin(uint16_t count, uint16_t firstTrack, uint32_t seed, SmartWeightFn weightOf,
+                       uint8_t recentWindow) {
+  if (count == 0 || count > SMART_SHUFFLE_MAX_TRACKS || !weightOf) return false;
+  trackCount = count;
+  weightFn = weightOf;
+  rng = seed ? seed : 0x9E3779B9u; // xorshift state must not be zero
+  topBit = 1;
+  while (topBit * 2u <= trackCount) topBit *= 2;
+  uint16_t cap = count / 2 < SMART_SHUFFLE_RECENT ? count / 2 : SMART_SHUFFLE_RECENT;
+  window = recentWindow < cap ? recentWindow : cap;
+
+  // Linear build: each node passes its sum up to its parent once.
+  totalWeight = 0;
+  weights[0] = 0;
+  for (uint16_t t = 1; t <= trackCount; ++t) {
+    weights[t] = weightFn(t);
+    tree[t] = weights[t];
+    totalWeight += weights[t];
+  }
+  for (uint16_t t = 1; t <= trackCount; ++t) {
+    uint16_t parent = t + (t & -t);
+    if (parent <= trackCount) tree[parent] += tree[t];
+  }
+
+  recentHead = recentCount = back = 0;
+  pushRecent(constrain(firstTrack, (uint16_t)1, trackCount));
+  stats.builds++;
+  return true;
+}
+
+uint16_t smartShuffleCurrent() {
+  return recentCount ? recentAt(back) : 1;
+}
+
+uint16_t smartShuffleNext() {
+  if (back > 0) {
+    back--;
+    stats.replays++;
+    return recentAt(back);
+  }
+  // Every weight zero only if weightOf hands out zeros; stay put then.
+  if (totalWeight == 0) return smartShuffleCurrent();
+  uint32_t r = static_cast<uint32_t>((static_cast<uint64_t>(nextRandom()) * totalWeight) >> 32);
+  uint16_t track = findTrack(r);
+  pushRecent(track);
+  stats.draws++;
+  return track;
+}
+
+uint16_t smartShufflePrev() {
+  if (back + 1 < recentCount) back++;
+  return recentAt(back);
+}
+
+uint8_t smartShuffleWeight(const TrackStats &s) {
+  uint32_t w = 8 + 56UL * (s.plays + 1UL) / (s.plays + s.skips + 2UL);
+  return static_cast<uint8_t>(s.favorite ? w * 2 : w);
+}
+
+void smartShufflePrintStats(Print &out) {
+  out.print("smart shuffle tracks=");
+  out.print(trackCount);
+  out.print(" window=");
+  out.print(window);
+  out.print(" weight=");
+  out.print(totalWeight);
+  out.print(" draws=");
+  out.print(stats.draws);
+  out.print(" replays=");
+  out.print(stats.replays);
+  out.print(" builds=");
+  out.println(stats.builds);
+}
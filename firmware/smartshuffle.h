@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "trackstats.h"
+
+// Weighted shuffle over tracks 1..count: each draw picks a track with
+// probability proportional to its weight, so tracks that get played through
+// come up more often than ones that get skipped. Weights sit in a Fenwick
+// tree (SMART_SHUFFLE_MAX_TRACKS entries), which makes a draw a prefix-sum
+// descent and a weight change a walk up the tree, both O(log n).
+//
+// The last `window` tracks drawn are held at weight zero and get their weight
+// back, re-read through `weightOf`, when they drop out of the window; so a
+// track cannot come round again soon, and a play or skip it picked up in the
+// meantime counts from then on. The same ring of recent tracks is what Prev
+// walks back through; Next then replays it forward before drawing again.
+// Unlike shuffle.h there are no epochs: the order never runs out.
+typedef uint8_t (*SmartWeightFn)(uint16_t track);
+
+// false if `count` is above SMART_SHUFFLE_MAX_TRACKS. `window` is clamped to
+// SMART_SHUFFLE_RECENT and to half the tracks so there is always a choice.
+bool smartShuffleBegin(uint16_t count, uint16_t firstTrack, uint32_t seed, SmartWeightFn weightOf,
+                       uint8_t window = SMART_SHUFFLE_RECENT);
+uint16_t smartShuffleCurrent();
+uint16_t smartShuffleNext();
+uint16_t smartShufflePrev();
+// Chance of a track relative to the others, from its history: the smoothed
+// share of plays among plays and skips, doubled for favourites (8..128).
+uint8_t smartShuffleWeight(const TrackStats &stats);
+void smartShufflePrintStats(Print &out);
@@ -0,0 +1,19 @@
+#include "track_index.h"
+
+#include "track_index_data.h"
+
+bool trackIndexFind(uint8_t folder, uint16_t file, TrackInfo &out) {
+  if (folder > 99 || file == 0) return false;
+  uint16_t first = TRACK_INDEX_FOLDER_FIRST[folder];
+  if (file > TRACK_INDEX_FOLDER_FIRST[folder + 1] - first) return false;
+  const TrackRecord &rec = TRACK_INDEX_RECORDS[first + file - 1];
+  if (rec.title == 0 && rec.seconds == 0) return false;
+  out.title = TRACK_INDEX_POOL + rec.title;
+  out.artist = TRACK_INDEX_POOL + TRACK_INDEX_ARTISTS[rec.artist];
+  out.seconds = rec.seconds;
+  return true;
+}
+
+uint16_t trackIndexSize() {
+  return TRACK_INDEX_RECORD_COUNT;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Track names and durations baked into flash by tools/make_track_index.py
+// (the DFPlayer cannot read file names). Records are stored folder by folder
+// with gaps filled, so a lookup is one table read plus one record read.
+struct TrackRecord {
+  uint32_t title;   // offset into the string pool, 0 = unknown
+  uint16_t artist;  // index into the artist table
+  uint16_t seconds; // 0 = unknown
+};
+
+struct TrackInfo {
+  const char *title;  // never null; empty when unknown
+  const char *artist; // never null; empty when unknown
+  uint16_t seconds;
+};
+
+// Folder 0 is /mp3, 1..99 are /01../99. False if the file has no entry.
+bool trackIndexFind(uint8_t folder, uint16_t file, TrackInfo &out);
+uint16_t trackIndexSize();
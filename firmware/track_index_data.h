@@ -0,0 +1,35 @@
+#pragma once
+
+// Generated by tools/make_track_index.py from an empty card. Do not edit;
+// regenerate whenever the SD card content changes.
+// 0 records (0 named), 0 artists, 1 pool bytes, 203 bytes total.
+
+#include "track_index.h"
+
+static const uint16_t TRACK_INDEX_RECORD_COUNT = 0;
+
+static const char TRACK_INDEX_POOL[] PROGMEM =
+    "\0";
+
+static const uint32_t TRACK_INDEX_ARTISTS[] PROGMEM = {
+    0,
+};
+
+static const TrackRecord TRACK_INDEX_RECORDS[] PROGMEM = {
+    {0, 0, 0},
+};
+
+// Folder 0 is /mp3; records of folder f are [first[f], first[f + 1]).
+static const uint16_t TRACK_INDEX_FOLDER_FIRST[101] PROGMEM = {
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0,
+};
@@ -0,0 +1,389 @@
+#include "trackstats.h"
+
+#include <esp_partition.h>
+#include <stddef.h>
+
+static const char *const PARTITION_LABEL = "trkstats";
+static const uint32_t SECTOR_BYTES = 4096;
+static const uint16_t RECORD_BYTES = 16;
+static const uint16_t SLOTS_PER_SECTOR = SECTOR_BYTES / RECORD_BYTES; // slot 0 is the header
+static const uint8_t MAX_SECTORS = 64;
+static const uint8_t KIND_HEADER = 0xA5;
+static const uint8_t KIND_TRACK = 0x5A;
+static const uint8_t KIND_EMPTY = 0xFF; // erased flash
+static const uint16_t NO_SLOT = 0xFFFF;
+static const uint8_t READ_CHUNK = 16; // records per flash read while scanning
+static const uint8_t HASH_BITS = 12;
+static const uint16_t HASH_SLOTS = 1 << HASH_BITS;
+static_assert(STATS_MAX_TRACKS * 2 <= HASH_SLOTS, "keep the hash index at most half full");
+
+struct LogRecord {
+  uint8_t kind;
+  uint8_t folder;
+  uint16_t file;
+  uint16_t plays;
+  uint16_t skips;
+  uint8_t favorite;
+  uint8_t reserved;
+  uint16_t check; // over every other byte; a torn write fails it
+  uint32_t seq;   // headers: ring order
+};
+static_assert(sizeof(LogRecord) == RECORD_BYTES, "records are 16 bytes");
+
+struct StatsEntry {
+  uint8_t folder;
+  uint8_t favorite;
+  uint16_t file;
+  uint16_t plays;
+  uint16_t skips;
+  uint16_t slot; // flash slot of the newest record, NO_SLOT = not written
+};
+
+struct StoreStats {
+  uint32_t appends;
+  uint32_t compactions; // sectors reclaimed
+  uint32_t moved;       // live records copied out of them
+  uint16_t torn;        // records and sectors that failed their check at boot
+  uint16_t dropped;     // tracks not kept because the index was full
+  uint32_t loadUs;
+  uint32_t favoritesUs; // last query times
+  uint32_t mostPlayedUs;
+};
+
+static const esp_partition_t *partition = nullptr;
+static uint8_t sectorCount = 0;
+static uint8_t headSector = 0;
+static uint8_t tailSector = 0;
+static uint16_t headSlot = SLOTS_PER_SECTOR; // next free slot in the head sector
+static uint8_t freeSectors = 0;
+static uint32_t headSeq = 0;
+static bool compacting = false;
+static uint16_t liveCapacity = STATS_MAX_TRACKS;
+
+static StatsEntry entries[STATS_MAX_TRACKS];
+static uint16_t entryCount = 0;
+static uint16_t buckets[HASH_SLOTS]; // entry index + 1, 0 = empty
+static StoreStats stats{};
+
+static uint16_t recordCheck(const LogRecord &r) {
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&r);
+  uint16_t sum = 0x5AA5;
+  for (uint8_t i = 0; i < RECORD_BYTES; ++i) {
+    if (i == offsetof(LogRecord, check) || i == offsetof(LogRecord, check) + 1) continue;
+    sum = static_cast<uint16_t>((sum << 3) | (sum >> 13)) ^ bytes[i];
+  }
+  return sum;
+}
+
+static StatsEntry *find(uint8_t folder, uint16_t file, bool create) {
+  uint32_t key = (static_cast<uint32_t>(folder) << 16) | file;
+  uint16_t i = (key * 2654435761u) >> (32 - HASH_BITS);
+  while (buckets[i] != 0) {
+    StatsEntry &e = entries[buckets[i] - 1];
+    if (e.folder == folder && e.file == file) return &e;
+    i = (i + 1) & (HASH_SLOTS - 1);
+  }
+  if (!create) return nullptr;
+  if (entryCount >= liveCapacity) {
+    stats.dropped++;
+    return nullptr;
+  }
+  StatsEntry &e = entries[entryCount++];
+  e = StatsEntry{folder, 0, file, 0, 0, NO_SLOT};
+  buckets[i] = entryCount;
+  return &e;
+}
+
+static bool readRecord(uint16_t slot, LogRecord &r) {
+  return esp_partition_read(partition, static_cast<uint32_t>(slot) * RECORD_BYTES, &r, RECORD_BYTES) == ESP_OK;
+}
+
+static bool writeRecord(uint16_t slot, LogRecord &r) {
+  r.check = recordCheck(r);
+  return esp_partition_write(partition, static_cast<uint32_t>(slot) * RECORD_BYTES, &r, RECORD_BYTES) == ESP_OK;
+}
+
+static bool validRecord(const LogRecord &r, uint8_t kind) {
+  return r.kind == kind && r.check == recordCheck(r);
+}
+
+static void eraseSector(uint8_t sector) {
+  esp_partition_erase_range(partition, sector * SECTOR_BYTES, SECTOR_BYTES);
+}
+
+static bool readChunk(uint16_t slot, LogRecord *chunk) {
+  return esp_partition_read(partition, static_cast<uint32_t>(slot) * RECORD_BYTES, chunk,
+                            READ_CHUNK * RECORD_BYTES) == ESP_OK;
+}
+
+static bool sectorBlank(uint8_t sector) {
+  LogRecord chunk[READ_CHUNK];
+  for (uint16_t i = 0; i < SLOTS_PER_SECTOR; i += READ_CHUNK) {
+    if (!readChunk(sector * SLOTS_PER_SECTOR + i, chunk)) return false;
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(chunk);
+    for (uint16_t b = 0; b < sizeof(chunk); ++b) {
+      if (bytes[b] != 0xFF) return false;
+    }
+  }
+  return true;
+}
+
+static void openSector(uint8_t sector) {
+  if (freeSectors == sectorCount) tailSector = sector;
+  LogRecord header;
+  memset(&header, 0xFF, sizeof(header));
+  header.kind = KIND_HEADER;
+  header.seq = ++headSeq;
+  writeRecord(sector * SLOTS_PER_SECTOR, header);
+  headSector = sector;
+  headSlot = 1;
+  freeSectors--;
+}
+
+static bool compactOne();
+
+static void append(StatsEntry &e) {
+  if (!partition) return;
+  if (headSlot == SLOTS_PER_SECTOR) {
+    // One free sector stays back for compaction to copy into. Live records
+    // never fill more than liveCapacity, so each pass gains ground.
+    for (uint8_t pass = 0; !compacting && freeSectors <= 1 && pass < sectorCount; ++pass) {
+      if (!compactOne()) break;
+    }
+    if (freeSectors == 0) return;
+    openSector((headSector + 1) % sectorCount);
+  }
+  LogRecord r;
+  r.kind = KIND_TRACK;
+  r.folder = e.folder;
+  r.file = e.file;
+  r.plays = e.plays;
+  r.skips = e.skips;
+  r.favorite = e.favorite;
+  r.reserved = 0xFF;
+  r.seq = 0xFFFFFFFF;
+  uint16_t slot = headSector * SLOTS_PER_SECTOR + headSlot++;
+  if (!writeRecord(slot, r)) return;
+  e.slot = slot;
+  stats.appends++;
+}
+
+// Copies the live records of the oldest sector to the head and erases it.
+static bool compactOne() {
+  if (sectorCount - freeSectors < 2) return false; // only the head is in use
+  uint8_t sector = tailSector;
+  uint16_t first = sector * SLOTS_PER_SECTOR;
+  compacting = true;
+  for (uint16_t i = 0; i < entryCount; ++i) {
+    StatsEntry &e = entries[i];
+    if (e.slot != NO_SLOT && e.slot >= first && e.slot < first + SLOTS_PER_SECTOR) {
+      append(e);
+      stats.moved++;
+    }
+  }
+  compacting = false;
+  eraseSector(sector);
+  tailSector = (sector + 1) % sectorCount;
+  freeSectors++;
+  stats.compactions++;
+  return true;
+}
+
+// Replays one sector; leaves headSlot at its first unwritten slot.
+static void replaySector(uint8_t sector) {
+  LogRecord chunk[READ_CHUNK];
+  headSlot = SLOTS_PER_SECTOR;
+  for (uint16_t i = 1; i < SLOTS_PER_SECTOR; ++i) {
+    uint16_t slot = sector * SLOTS_PER_SECTOR + i;
+    if (i == 1 || i % READ_CHUNK == 0) {
+      // The first chunk starts at the header so every read stays aligned.
+      if (!readChunk(slot - i % READ_CHUNK, chunk)) return;
+    }
+    const LogRecord &r = chunk[i % READ_CHUNK];
+    if (r.kind == KIND_EMPTY) {
+      headSlot = i;
+      return;
+    }
+    if (!validRecord(r, KIND_TRACK)) {
+      stats.torn++;
+      continue;
+    }
+    StatsEntry *e = find(r.folder, r.file, true);
+    if (!e) continue;
+    e->plays = r.plays;
+    e->skips = r.skips;
+    e->favorite = r.favorite;
+    e->slot = slot;
+  }
+}
+
+bool statsBegin() {
+  unsigned long startedUs = micros();
+  entryCount = 0;
+  memset(buckets, 0, sizeof(buckets));
+  partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, PARTITION_LABEL);
+  sectorCount = partition ? min<uint32_t>(partition->size / SECTOR_BYTES, MAX_SECTORS) : 0;
+  if (sectorCount < 3) {
+    partition = nullptr;
+    return false;
+  }
+  // Two sectors of slack: the head being filled and the one compaction copies into.
+  liveCapacity = min<uint32_t>(STATS_MAX_TRACKS, (sectorCount - 2) * (SLOTS_PER_SECTOR - 1));
+
+  uint32_t seqs[MAX_SECTORS];
+  bool used[MAX_SECTORS];
+  uint8_t usedCount = 0;
+  for (uint8_t s = 0; s < sectorCount; ++s) {
+    LogRecord header;
+    used[s] = readRecord(s * SLOTS_PER_SECTOR, header) && validRecord(header, KIND_HEADER);
+    if (used[s]) {
+      seqs[s] = header.seq;
+      usedCount++;
+    } else if (!sectorBlank(s)) {
+      // Torn header or an interrupted erase.
+      stats.torn++;
+      eraseSector(s);
+    }
+  }
+
+  // Replay oldest first so the newest record of each track wins.
+  headSeq = 0;
+  freeSectors = sectorCount - usedCount;
+  headSector = sectorCount - 1;
+  headSlot = SLOTS_PER_SECTOR;
+  uint32_t floor = 0;
+  for (uint8_t n = 0; n < usedCount; ++n) {
+    uint8_t next = 0;
+    uint32_t best = 0xFFFFFFFF;
+    for (uint8_t s = 0; s < sectorCount; ++s) {
+      if (used[s] && seqs[s] >= floor && seqs[s] <= best) {
+        best = seqs[s];
+        next = s;
+      }
+    }
+    if (n == 0) tailSector = next;
+    replaySector(next);
+    headSector = next;
+    headSeq = best;
+    floor = best + 1;
+  }
+  stats.loadUs = micros() - startedUs;
+  return true;
+}
+
+void statsLoop() {
+  if (partition && freeSectors < STATS_COMPACT_BELOW) compactOne();
+}
+
+TrackStats statsGet(const TrackLocation &loc) {
+  const StatsEntry *e = find(loc.folder, loc.file, false);
+  if (!e) return TrackStats{0, 0, false};
+  return TrackStats{e->plays, e->skips, e->favorite != 0};
+}
+
+void statsNotePlay(const TrackLocation &loc) {
+  StatsEntry *e = find(loc.folder, loc.file, true);
+  if (!e) return;
+  if (e->plays < 0xFFFF) e->plays++;
+  append(*e);
+}
+
+void statsNoteSkip(const TrackLocation &loc) {
+  StatsEntry *e = find(loc.folder, loc.file, true);
+  if (!e) return;
+  if (e->skips < 0xFFFF) e->skips++;
+  append(*e);
+}
+
+bool statsToggleFavorite(const TrackLocation &loc) {
+  StatsEntry *e = find(loc.folder, loc.file, true);
+  if (!e) return false;
+  e->favorite = !e->favorite;
+  append(*e);
+  return e->favorite;
+}
+
+bool statsFavorite(const TrackLocation &loc) {
+  const StatsEntry *e = find(loc.folder, loc.file, false);
+  return e && e->favorite;
+}
+
+// Keeps the `max` best entries that `wanted` accepts, best first: one pass
+// with an insertion into a short sorted list, O(entries * max).
+static uint16_t selectTop(TrackLocation *out, uint16_t max, bool (*wanted)(const StatsEntry &),
+                          bool (*better)(const StatsEntry &, const StatsEntry &)) {
+  static uint16_t picked[PLAYLIST_CAPACITY];
+  if (max > PLAYLIST_CAPACITY) max = PLAYLIST_CAPACITY;
+  uint16_t count = 0;
+  for (uint16_t i = 0; i < entryCount; ++i) {
+    const StatsEntry &e = entries[i];
+    if (!wanted(e)) continue;
+    if (count == max && !better(e, entries[picked[count - 1]])) continue;
+    uint16_t at = count < max ? count++ : count - 1;
+    while (at > 0 && better(e, entries[picked[at - 1]])) {
+      picked[at] = picked[at - 1];
+      --at;
+    }
+    picked[at] = i;
+  }
+  for (uint16_t i = 0; i < count; ++i) out[i] = TrackLocation{entries[picked[i]].folder, entries[picked[i]].file};
+  return count;
+}
+
+uint16_t statsFavorites(TrackLocation *out, uint16_t max) {
+  unsigned long startedUs = micros();
+  uint16_t count = selectTop(
+      out, max, [](const StatsEntry &e) { return e.favorite != 0; },
+      [](const StatsEntry &a, const StatsEntry &b) {
+        return a.folder != b.folder ? a.folder < b.folder : a.file < b.file;
+      });
+  stats.favoritesUs = micros() - startedUs;
+  return count;
+}
+
+uint16_t statsMostPlayed(TrackLocation *out, uint16_t max) {
+  unsigned long startedUs = micros();
+  uint16_t count = selectTop(
+      out, max, [](const StatsEntry &e) { return e.plays > 0; },
+      [](const StatsEntry &a, const StatsEntry &b) {
+        return a.plays != b.plays ? a.plays > b.plays : a.skips < b.skips;
+      });
+  stats.mostPlayedUs = micros() - startedUs;
+  return count;
+}
+
+void statsPrintStats(Print &out) {
+  uint16_t favorites = 0;
+  for (uint16_t i = 0; i < entryCount; ++i) favorites += entries[i].favorite ? 1 : 0;
+  out.print("stats tracks=");
+  out.print(entryCount);
+  out.print("/");
+  out.print(liveCapacity);
+  out.print(" favorites=");
+  out.print(favorites);
+  if (!partition) {
+    out.println(" (no trkstats partition, not saved)");
+    return;
+  }
+  out.print(" sectors=");
+  out.print(sectorCount - freeSectors);
+  out.print("/");
+  out.print(sectorCount);
+  out.print(" appends=");
+  out.print(stats.appends);
+  out.print(" compactions=");
+  out.print(stats.compactions);
+  out.print(" moved=");
+  out.print(stats.moved);
+  out.print(" torn=");
+  out.print(stats.torn);
+  out.print(" dropped=");
+  out.print(stats.dropped);
+  out.print(" load=");
+  out.print(stats.loadUs);
+  out.print("us query fav=");
+  out.print(stats.favoritesUs);
+  out.print("us top=");
+  out.print(stats.mostPlayedUs);
+  out.println("us");
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <Arduino.h>
+#include "config.h"
+#include "library.h"
+
+// Per-track play and skip counts and the favourite flag, keyed by folder/file
+// so they survive a re-numbered library.
+//
+// Flash layout: the "trkstats" data partition (partitions.csv) is a ring of
+// 4 KB sectors of fixed 16-byte records. Every update appends the track's
+// whole record at the head, so an update is one small write and the newest
+// record of a track wins. Each sector starts with a header carrying a
+// sequence number that orders the ring at boot. Compaction copies the live
+// records out of the oldest sector and erases it, so erases walk the ring and
+// wear is spread evenly. RAM holds one entry per known track behind a hash
+// index; lookups, updates and the queries below never touch flash.
+struct TrackStats {
+  uint16_t plays;
+  uint16_t skips;
+  bool favorite;
+};
+
+// Loads the index from the partition; without the partition stats are kept
+// in RAM only.
+bool statsBegin();
+// Compacts one sector when free space runs low. Call while the UART is quiet:
+// a sector erase stalls flash access for tens of ms.
+void statsLoop();
+TrackStats statsGet(const TrackLocation &loc);
+void statsNotePlay(const TrackLocation &loc);
+void statsNoteSkip(const TrackLocation &loc);
+bool statsToggleFavorite(const TrackLocation &loc); // new state
+bool statsFavorite(const TrackLocation &loc);
+// Favourites in folder/file order, and tracks by play count (fewer skips
+// first on a tie). Both return how many entries were written to `out`.
+uint16_t statsFavorites(TrackLocation *out, uint16_t max);
+uint16_t statsMostPlayed(TrackLocation *out, uint16_t max);
+void statsPrintStats(Print &out);
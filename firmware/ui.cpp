@@ -4,9 +4,20 @@
 #include <Adafruit_GC9A01A.h>
 #include <SPI.h>
 #include <math.h>
+#include "dial.h"
+#include "governor.h"
+#include "latency.h"
+#include "panel.h"
+#include "track_index.h"
 #include "vinyl_assets.h"
 
-static Adafruit_GC9A01A display = Adafruit_GC9A01A(PIN_SCREEN_CS, PIN_SCREEN_DC, PIN_SCREEN_MOSI, PIN_SCREEN_SCK, PIN_SCREEN_RST);
+static Panel display(PIN_SCREEN_CS, PIN_SCREEN_DC, PIN_SCREEN_MOSI, PIN_SCREEN_SCK, PIN_SCREEN_RST);
+
+struct ModeTransition {
+  bool active = false;
+  UITransition kind = UITransition::Cut;
+  int16_t progress = 0; // rows, columns or iris radius revealed so far
+};
 
 struct UIStateCache {
   bool initialized = false;
@@ -18,13 +29,14 @@ struct UIStateCache {
 };
 
 static UIStateCache uiCache;
+static ModeTransition transition;
 static unsigned long lastHudRefresh = 0;
 static unsigned long lastBatteryRefresh = 0;
 static unsigned long lastBackgroundRefresh = 0;
 static unsigned long lastPulse = 0;
 static unsigned long volumeOverlayUntilMs = 0;
 static bool backgroundDrawn = false;
-static bool volumeOverlayActive = false;
+static bool overlayActive = false;
 static float overlayVolumeLerp = DEFAULT_VOLUME;
 static uint8_t btAnimPhase = 0;
 static unsigned long lastBtAnim = 0;
@@ -32,6 +44,27 @@ static unsigned long lastVinylStep = 0;
 static uint16_t vinylAngle = 0;
 static bool overlayPendingClear = false;
 static bool hudNeedsRestore = false;
+static unsigned long lastEqDraw = 0;
+static bool eqShown = false;
+static int8_t spinnerStatic = -1; // 0 = still skin, 1 = frozen spokes, -1 = none/animating
+static unsigned long panelPowerSince = 0;
+static unsigned long panelWokeAt = 0;
+static uint32_t panelPowerMs[3] = {0, 0, 0};
+static bool scanlinesEnabled = UI_FX_SCANLINES;
+static bool batteryWarning = false;
+static int16_t overlayShownVolume = -1;
+// What the overlay slot shows. The settings selector and the track dial share
+// the volume overlay's rect and save-under; while either is up the volume
+// overlay stays away.
+enum class OverlayKind : uint8_t {
+  Volume,
+  Settings,
+  Dial
+};
+static OverlayKind overlayKind = OverlayKind::Volume;
+static bool overlayDirty = false; // repaint the whole overlay, not just what changed
+static SettingsField settingsShownField = SettingsField::Eq;
+static DialState dialShown{};     // as last drawn, so an edit repaints only changed cells
 
 static void formatTime(char *buf, size_t len, const ClockTime &clock) {
   if (!clock.valid) {
@@ -64,13 +97,8 @@ static void drawSafeGridLineH(int16_t y) {
   display.drawFastHLine(x0, y, x1 - x0, COLOR_GRID);
 }
 
-static void drawBackground() {
-  display.fillScreen(COLOR_BG);
-  display.drawRGBBitmap(0, 0, VINYL_UI_BITMAP_PTR, VINYL_UI_WIDTH, VINYL_UI_HEIGHT);
-}
-
 static void blitVinylRegion(int16_t x, int16_t y, int16_t w, int16_t h) {
-  uint16_t lineBuf[UI_SAFE_DIAMETER];
+  alignas(4) uint16_t lineBuf[VINYL_UI_WIDTH];
   int16_t x0 = max<int16_t>(0, x);
   int16_t y0 = max<int16_t>(0, y);
   int16_t x1 = min<int16_t>(VINYL_UI_WIDTH, x + w);
@@ -80,7 +108,72 @@ static void blitVinylRegion(int16_t x, int16_t y, int16_t w, int16_t h) {
     for (int16_t col = x0; col < x1; ++col) {
       lineBuf[col - x0] = pgm_read_word(&VINYL_UI_BITMAP_PTR[idx++]);
     }
-    display.drawRGBBitmap(x0, row, lineBuf, x1 - x0, 1);
+    display.pushLine(x0, row, lineBuf, x1 - x0);
+  }
+}
+
+static void drawBackground() {
+  // The skin goes through the line blit path so an open save-under stays coherent.
+  if (VINYL_UI_WIDTH < SCREEN_SIZE || VINYL_UI_HEIGHT < SCREEN_SIZE) {
+    display.fillScreen(COLOR_BG);
+  }
+  blitVinylRegion(0, 0, VINYL_UI_WIDTH, VINYL_UI_HEIGHT);
+  eqShown = false;
+  spinnerStatic = -1;
+}
+
+static void startTransition(UITransition kind) {
+  transition.active = true;
+  transition.kind = kind;
+  transition.progress = 0;
+  eqShown = false;
+  spinnerStatic = -1;
+}
+
+// Iris half-width of row offset dy at radius r. Consecutive steps reuse the
+// same rounding, so the revealed annuli tile without gaps or overdraw.
+static int16_t irisHalfWidth(int16_t r, int16_t dy) {
+  int32_t sq = static_cast<int32_t>(r) * r - static_cast<int32_t>(dy) * dy;
+  return sq > 0 ? static_cast<int16_t>(sqrtf(static_cast<float>(sq))) : 0;
+}
+
+// Push one frame's share of the skin. Returns true once the skin is complete.
+static bool stepTransition() {
+  const int16_t budget = UI_TRANSITION_LINES_PER_FRAME;
+  switch (transition.kind) {
+    case UITransition::Wipe:
+      blitVinylRegion(0, transition.progress, VINYL_UI_WIDTH, budget);
+      transition.progress += budget;
+      return transition.progress >= VINYL_UI_HEIGHT;
+    case UITransition::Slide:
+      blitVinylRegion(transition.progress, 0, budget, VINYL_UI_HEIGHT);
+      transition.progress += budget;
+      return transition.progress >= VINYL_UI_WIDTH;
+    case UITransition::Iris: {
+      // Grow the radius so the new annulus holds about `budget` lines of pixels.
+      const int16_t maxRadius = static_cast<int16_t>(SCREEN_SIZE * 0.7072f) + 1;
+      int16_t r0 = transition.progress;
+      float area = static_cast<float>(budget) * VINYL_UI_WIDTH / PI;
+      int16_t r1 = static_cast<int16_t>(sqrtf(static_cast<float>(r0) * r0 + area)) + 1;
+      if (r1 > maxRadius) r1 = maxRadius;
+      for (int16_t dy = -r1 + 1; dy < r1; ++dy) {
+        int16_t outer = irisHalfWidth(r1, dy);
+        int16_t inner = irisHalfWidth(r0, dy);
+        int16_t y = CENTER_Y + dy;
+        if (inner == 0) {
+          blitVinylRegion(CENTER_X - outer, y, outer * 2, 1);
+        } else if (outer > inner) {
+          blitVinylRegion(CENTER_X - outer, y, outer - inner, 1);
+          blitVinylRegion(CENTER_X + inner, y, outer - inner, 1);
+        }
+      }
+      transition.progress = r1;
+      return r1 >= maxRadius;
+    }
+    case UITransition::Cut:
+    default:
+      drawBackground();
+      return true;
   }
 }
 
@@ -119,12 +212,38 @@ static void drawTrackPanel(const AudioStatus &audio, bool pulse) {
   const int16_t x = CENTER_X - w / 2;
   const int16_t y = UI_SAFE_TOP + 6;
   display.fillRect(x, y, w, h, COLOR_BG);
-  display.setTextSize(2);
-  display.setTextColor(pulse ? COLOR_AMBER : COLOR_TEXT, COLOR_BG);
-  display.setCursor(x + 6, y + 4);
-  char buf[12];
-  snprintf(buf, sizeof(buf), "TRACK %04d", audio.track);
+  uint16_t color = pulse ? COLOR_AMBER : COLOR_TEXT;
+  TrackInfo info;
+  if (!trackIndexFind(audio.folder, audio.file, info) || info.title[0] == '\0') {
+    display.setTextSize(2);
+    display.setTextColor(color, COLOR_BG);
+    display.setCursor(x + 6, y + 4);
+    char buf[12];
+    snprintf(buf, sizeof(buf), "TRACK %04d", audio.track);
+    display.print(buf);
+    return;
+  }
+
+  // Indexed track: title over artist and length, 6 px per character.
+  const uint8_t cols = (w - 12) / 6;
+  char buf[32];
+  display.setTextSize(1);
+  display.setTextColor(color, COLOR_BG);
+  display.setCursor(x + 6, y + 2);
+  snprintf(buf, sizeof(buf), "%.*s", cols, info.title);
+  display.print(buf);
+
+  char length[8] = "";
+  if (info.seconds > 0) snprintf(length, sizeof(length), "%u:%02u", info.seconds / 60, info.seconds % 60);
+  uint8_t lengthCols = strlen(length);
+  display.setTextColor(COLOR_ACCENT, COLOR_BG);
+  display.setCursor(x + 6, y + 13);
+  snprintf(buf, sizeof(buf), "%.*s", lengthCols ? cols - lengthCols - 1 : cols, info.artist);
   display.print(buf);
+  if (lengthCols) {
+    display.setCursor(x + w - 6 - lengthCols * 6, y + 13);
+    display.print(length);
+  }
 }
 
 static void drawStatePanel(const AudioStatus &audio, bool pulse) {
@@ -136,8 +255,10 @@ static void drawStatePanel(const AudioStatus &audio, bool pulse) {
   display.setTextSize(1);
   display.setTextColor(pulse ? COLOR_AMBER : COLOR_ACCENT, COLOR_BG);
   display.setCursor(x + 2, y + 4);
-  char buf[8];
-  snprintf(buf, sizeof(buf), "%d/%d", audio.track, audio.trackCount);
+  char buf[12];
+  static const char *const SHUFFLE_MARKS[] = {"", "~", "+"};
+  snprintf(buf, sizeof(buf), "%s%d/%d%s", SHUFFLE_MARKS[static_cast<uint8_t>(audio.shuffle)], audio.track,
+           audio.trackCount, audio.favorite ? "*" : "");
   display.print(buf);
 }
 
@@ -209,6 +330,14 @@ static void drawVinylSpinner(bool spinning) {
   display.drawCircle(CENTER_X, CENTER_Y, 10, COLOR_ACCENT);
 }
 
+static PanelRect volumeOverlayRect() {
+  const int16_t w = UI_SAFE_DIAMETER - 34;
+  const int16_t h = 26;
+  const int16_t x = UI_SAFE_LEFT + 17;
+  const int16_t y = CENTER_Y - h / 2;
+  return {static_cast<int16_t>(x - 2), static_cast<int16_t>(y - 2), static_cast<int16_t>(w + 4), static_cast<int16_t>(h + 4)};
+}
+
 static void drawVolumeOverlayBar(uint8_t volume, float lerpValue) {
   const int16_t w = UI_SAFE_DIAMETER - 34;
   const int16_t h = 26;
@@ -232,10 +361,94 @@ static void drawVolumeOverlayBar(uint8_t volume, float lerpValue) {
   display.fillRoundRect(barX + 2, barY + 2, fill, barH - 4, 2, COLOR_TEXT);
 }
 
+// One field at a time: name, value between arrows, and a dot per field.
+static void drawSettingsOverlay(SettingsField field) {
+  const int16_t w = UI_SAFE_DIAMETER - 34;
+  const int16_t h = 26;
+  const int16_t x = UI_SAFE_LEFT + 17;
+  const int16_t y = CENTER_Y - h / 2;
+
+  display.fillRoundRect(x, y, w, h, 8, COLOR_BG);
+  display.drawRoundRect(x, y, w, h, 8, COLOR_ACCENT);
+  display.setTextSize(1);
+  display.setTextColor(COLOR_ACCENT, COLOR_BG);
+  display.setCursor(x + 10, y + 9);
+  display.print(settingsFieldName(field));
+
+  char value[12];
+  settingsFormatValue(field, value, sizeof(value));
+  display.setTextColor(COLOR_TEXT, COLOR_BG);
+  display.setCursor(x + 52, y + 9);
+  display.print("< ");
+  display.print(value);
+  display.print(" >");
+
+  for (uint8_t i = 0; i < SETTINGS_FIELD_COUNT; ++i) {
+    uint16_t color = i == static_cast<uint8_t>(field) ? COLOR_TEXT : COLOR_GRID;
+    display.fillCircle(x + w - 10 - SETTINGS_FIELD_COUNT * 7 + i * 7, y + h / 2, 2, color);
+  }
+}
+
+static const int16_t DIAL_CELL_W = 14;
+
+static void drawDialCell(uint8_t index, uint8_t digit, bool selected) {
+  const int16_t h = 26;
+  const int16_t x = UI_SAFE_LEFT + 17 + 52 + index * DIAL_CELL_W;
+  const int16_t y = CENTER_Y - h / 2;
+  display.setTextSize(2);
+  display.setTextColor(selected ? COLOR_TEXT : COLOR_ACCENT, COLOR_BG);
+  display.setCursor(x + 1, y + 4);
+  display.print(digit);
+  display.fillRect(x, y + 21, DIAL_CELL_W - 2, 2, selected ? COLOR_TEXT : COLOR_BG);
+}
+
+static void drawDialOverlay(const DialState &dial) {
+  const int16_t w = UI_SAFE_DIAMETER - 34;
+  const int16_t h = 26;
+  const int16_t x = UI_SAFE_LEFT + 17;
+  const int16_t y = CENTER_Y - h / 2;
+
+  display.fillRoundRect(x, y, w, h, 8, COLOR_BG);
+  display.drawRoundRect(x, y, w, h, 8, COLOR_ACCENT);
+  display.setTextSize(1);
+  display.setTextColor(COLOR_ACCENT, COLOR_BG);
+  display.setCursor(x + 10, y + 9);
+  display.print("TRACK");
+  display.setCursor(x + 56 + dial.count * DIAL_CELL_W, y + 9);
+  display.print("/");
+  display.print(dial.total);
+  for (uint8_t i = 0; i < dial.count; ++i) drawDialCell(i, dial.digits[i], i == dial.cursor);
+}
+
+static bool dialChanged(const DialState &dial) {
+  if (dial.cursor != dialShown.cursor) return true;
+  for (uint8_t i = 0; i < dial.count; ++i) {
+    if (dial.digits[i] != dialShown.digits[i]) return true;
+  }
+  return false;
+}
+
+// Digit and cursor changes repaint only their cells.
+static void updateDialOverlay(const DialState &dial, bool full) {
+  if (full) {
+    drawDialOverlay(dial);
+  } else {
+    for (uint8_t i = 0; i < dial.count; ++i) {
+      bool cursorMoved = (i == dial.cursor) != (i == dialShown.cursor);
+      if (dial.digits[i] != dialShown.digits[i] || cursorMoved) {
+        drawDialCell(i, dial.digits[i], i == dial.cursor);
+      }
+    }
+  }
+  dialShown = dial;
+}
+
 static void drawEqBars(unsigned long now) {
   const int16_t x = UI_SAFE_LEFT + 10;
   const int16_t y = UI_SAFE_TOP + 60;
   const int16_t h = 80;
+  lastEqDraw = now;
+  eqShown = true;
   display.fillRect(x, y, 40, h, COLOR_BG);
   for (uint8_t i = 0; i < 4; ++i) {
     uint16_t barH = (now / 50 + i * 30) % h;
@@ -243,36 +456,97 @@ static void drawEqBars(unsigned long now) {
   }
 }
 
-static void updateVolumeOverlay(const AudioStatus &audio, const BatteryStatus &bat, const ClockTime &clock, unsigned long now) {
-  if (!volumeOverlayActive && !overlayPendingClear) return;
+// Redraw every DFP widget in its current state. Used while a save-under is
+// capturing, so only the pixels inside the overlay rect are kept.
+static void composeDfpLayer(const AudioStatus &audio, const BatteryStatus &bat, const char *timeStr, bool warn) {
+  drawTopBar(bat, timeStr, warn);
+  drawTrackPanel(audio, false);
+  drawStatePanel(audio, false);
+  drawMessagePanel(timeStr);
+  drawVolumePanel(audio);
+  if (eqShown) drawEqBars(lastEqDraw);
+  drawBatteryPanel(bat);
+  drawVinylSpinner(spinnerStatic != 0 && (audio.state == PlaybackState::Playing) && audio.online);
+}
 
-  if (volumeOverlayActive) {
-    overlayVolumeLerp = audio.volume;
-    drawVolumeOverlayBar(audio.volume, overlayVolumeLerp);
+static void updateOverlay(const AudioStatus &audio, const BatteryStatus &bat, const char *timeStr, bool warn, unsigned long now) {
+  if (!overlayActive && !overlayPendingClear) return;
+
+  if (overlayActive) {
+    if (!display.saveUnderActive()) {
+      PanelRect rect = volumeOverlayRect();
+      if (display.saveUnderOpen(rect)) {
+        blitVinylRegion(rect.x, rect.y, rect.w, rect.h);
+        composeDfpLayer(audio, bat, timeStr, warn);
+        display.saveUnderCommit();
+      }
+      overlayShownVolume = -1;
+      overlayDirty = true;
+    }
+    bool full = overlayDirty || !display.saveUnderActive();
+    if (overlayKind == OverlayKind::Settings) {
+      if (full) {
+        display.overlayBegin();
+        drawSettingsOverlay(settingsShownField);
+        display.overlayEnd();
+        latencyMark(LatencyStage::Ui, micros());
+      }
+      overlayDirty = false;
+      return;
+    }
+    if (overlayKind == OverlayKind::Dial) {
+      const DialState &dial = dialState();
+      if (full || dialChanged(dial)) {
+        display.overlayBegin();
+        updateDialOverlay(dial, full);
+        display.overlayEnd();
+        latencyMark(LatencyStage::Ui, micros());
+      }
+      overlayDirty = false;
+      return;
+    }
+    // Draws beneath the overlay land in the save-under, so only a volume change repaints it.
+    if (overlayShownVolume != audio.volume || !display.saveUnderActive()) {
+      overlayVolumeLerp = audio.volume;
+      display.overlayBegin();
+      drawVolumeOverlayBar(audio.volume, overlayVolumeLerp);
+      display.overlayEnd();
+      latencyMark(LatencyStage::Ui, micros());
+      overlayShownVolume = audio.volume;
+    }
     if (now > volumeOverlayUntilMs) {
-      volumeOverlayActive = false;
+      overlayActive = false;
       overlayPendingClear = true;
-      hudNeedsRestore = true;
     }
   }
 
-  if (overlayPendingClear && !volumeOverlayActive) {
-    const int16_t w = UI_SAFE_DIAMETER - 34;
-    const int16_t h = 26;
-    const int16_t x = UI_SAFE_LEFT + 17;
-    const int16_t y = CENTER_Y - h / 2;
-    blitVinylRegion(x - 2, y - 2, w + 4, h + 4);
-    // redraw HUD elements overlapped by overlay region only
-    char timeBuf[10];
-    formatTime(timeBuf, sizeof(timeBuf), clock);
-    drawMessagePanel(timeBuf);
-    drawBatteryPanel(bat);
-    drawVolumePanel(audio);
+  if (overlayPendingClear && !overlayActive) {
+    if (display.saveUnderActive()) {
+      display.saveUnderClose();
+    } else {
+      // Arena exhausted when the overlay opened: repair from the skin and HUD.
+      PanelRect rect = volumeOverlayRect();
+      blitVinylRegion(rect.x, rect.y, rect.w, rect.h);
+      hudNeedsRestore = true;
+    }
     overlayPendingClear = false;
   }
 }
 
-static void drawBtHud(const BatteryStatus &bat, const ClockTime &clock, unsigned long now) {
+// Only the segments of the "now playing" bar; the frame is drawn by drawBtHud().
+static void drawBtSweep() {
+  const int16_t barX = UI_SAFE_LEFT + 24;
+  const int16_t barY = UI_SAFE_TOP + 50 + 46 + 12;
+  const int16_t barW = UI_SAFE_DIAMETER - 48;
+  const int16_t barH = 18;
+  int16_t segW = (barW - 12) / 10;
+  for (uint8_t i = 0; i < 10; ++i) {
+    uint16_t color = (i == btAnimPhase) ? COLOR_TEXT : COLOR_GRID;
+    display.fillRoundRect(barX + 6 + i * segW, barY + 4, segW - 4, barH - 8, 4, color);
+  }
+}
+
+static void drawBtHud(const BatteryStatus &bat, const ClockTime &clock) {
   char timeBuf[10];
   formatTime(timeBuf, sizeof(timeBuf), clock);
 
@@ -312,26 +586,58 @@ static void drawBtHud(const BatteryStatus &bat, const ClockTime &clock, unsigned
   const int16_t barH = 18;
   display.fillRoundRect(barX, barY, barW, barH, 8, COLOR_BG);
   display.drawRoundRect(barX, barY, barW, barH, 8, COLOR_ACCENT);
+  drawBtSweep();
+}
 
-  if (now - lastBtAnim > 120) {
-    lastBtAnim = now;
-    btAnimPhase = (btAnimPhase + 1) % 10;
+static void enterPanelPower(PanelPower mode, unsigned long now) {
+  PanelPower prev = display.power();
+  if (mode == prev) return;
+  panelPowerMs[static_cast<uint8_t>(prev)] += now - panelPowerSince;
+  panelPowerSince = now;
+  display.setPower(mode);
+  if (prev == PanelPower::Sleep) {
+    panelWokeAt = now;
+    // GRAM kept the last frame; skip the periodic skin refresh that came due while asleep.
+    lastBackgroundRefresh = now;
   }
-  int16_t segW = (barW - 12) / 10;
-  for (uint8_t i = 0; i < 10; ++i) {
-    uint16_t color = (i == btAnimPhase) ? COLOR_TEXT : COLOR_GRID;
-    display.fillRoundRect(barX + 6 + i * segW, barY + 4, segW - 4, barH - 8, 4, color);
+}
+
+static PanelPower panelPowerFor(unsigned long idleMs) {
+  if (UI_PANEL_SLEEP_MS > 0 && idleMs >= UI_PANEL_SLEEP_MS) return PanelPower::Sleep;
+  if (UI_PANEL_IDLE_MS > 0 && idleMs >= UI_PANEL_IDLE_MS) return PanelPower::Idle;
+  return PanelPower::Normal;
+}
+
+// Latched on below UI_WARNING_THRESHOLD (or on a red cell) and cleared only
+// UI_WARNING_CLEAR_MARGIN above it, so a reading that wobbles around the
+// threshold does not toggle the tint, and with it a full skin repaint.
+static bool updateBatteryWarning(const BatteryStatus &battery) {
+  if (battery.percent < UI_WARNING_THRESHOLD || battery.level == BatteryLevel::Red) {
+    batteryWarning = true;
+  } else if (battery.percent >= UI_WARNING_THRESHOLD + UI_WARNING_CLEAR_MARGIN) {
+    batteryWarning = false;
   }
+  return batteryWarning;
 }
 
 static bool audioChanged(const AudioStatus &a, const AudioStatus &b) {
-  return a.track != b.track || a.volume != b.volume || a.state != b.state || a.online != b.online || a.trackCount != b.trackCount;
+  return a.track != b.track || a.volume != b.volume || a.state != b.state || a.online != b.online || a.trackCount != b.trackCount ||
+         a.shuffle != b.shuffle || a.favorite != b.favorite;
 }
 
 static bool batteryChanged(const BatteryStatus &a, const BatteryStatus &b) {
   return a.percent != b.percent || a.level != b.level || fabs(a.voltage - b.voltage) > 0.02f;
 }
 
+static void rememberFrame(const AudioStatus &audio, const BatteryStatus &battery, UIMode mode, uint16_t minuteTick, const ClockTime &timeNow) {
+  uiCache.audio = audio;
+  uiCache.battery = battery;
+  uiCache.mode = mode;
+  uiCache.minuteTick = minuteTick;
+  uiCache.clock = timeNow;
+  uiCache.initialized = true;
+}
+
 void uiInit() {
   display.begin();
   display.setRotation(SCREEN_ROTATION);
@@ -339,19 +645,39 @@ void uiInit() {
   drawBackground();
   backgroundDrawn = true;
   lastBackgroundRefresh = millis();
+  panelPowerSince = lastBackgroundRefresh;
   uiCache.initialized = false;
 }
 
 void uiUpdate(const AudioStatus &audio, const BatteryStatus &battery, UIMode mode, const ClockTime &timeNow) {
   unsigned long now = millis();
+  uint32_t bytesBefore = display.bytesSent();
+  enterPanelPower(panelPowerFor(governorIdleMs(now)), now);
+  // Asleep, or still inside the SLPOUT settle window: leave uiCache untouched so
+  // the first awake frame redraws only what changed meanwhile.
+  if (display.power() == PanelPower::Sleep || now - panelWokeAt < UI_PANEL_WAKE_SETTLE_MS) {
+    governorSkipFrame(now);
+    return;
+  }
+  governorSelect(battery, now);
+  const FrameTier &tier = governorTier();
   char timeBuf[10];
   formatTime(timeBuf, sizeof(timeBuf), timeNow);
   uint16_t minuteTick = ((timeNow.hour % 24) * 60) + (timeNow.minute % 60);
 
+  // Line effects only touch the skin as it is blitted, so a change repaints it.
+  bool lowBattery = battery.level == BatteryLevel::Red;
+  bool warnTint = updateBatteryWarning(battery);
+  uint8_t fx = (scanlinesEnabled ? PANEL_FX_SCANLINES : 0) | (warnTint ? PANEL_FX_TINT : 0) | (lowBattery ? PANEL_FX_DIM : 0);
+  if (display.setLineFx(fx)) {
+    backgroundDrawn = false;
+  }
+
   if (!backgroundDrawn || now - lastBackgroundRefresh > UI_BACKGROUND_REFRESH_MS) {
     drawBackground();
     backgroundDrawn = true;
     lastBackgroundRefresh = now;
+    transition.active = false;
     uiCache.initialized = false;
   }
 
@@ -360,32 +686,52 @@ void uiUpdate(const AudioStatus &audio, const BatteryStatus &battery, UIMode mod
   bool batDiff = !uiCache.initialized || batteryChanged(battery, uiCache.battery);
   bool modeDiff = !uiCache.initialized || mode != uiCache.mode;
   bool timeDiff = !uiCache.initialized || minuteTick != uiCache.minuteTick;
+  // A real switch (not a cache invalidation, whose skin is already fresh) animates.
+  bool modeSwitched = uiCache.initialized && mode != uiCache.mode;
 
   if (modeDiff) {
     hudNeedsRestore = true;
     if (mode == UIMode::BT) {
-      volumeOverlayActive = false;
+      overlayActive = false;
       overlayPendingClear = false;
+      overlayKind = OverlayKind::Volume;
+      display.saveUnderDiscard();
     }
-    drawBackground();
-    backgroundDrawn = true;
-    lastBackgroundRefresh = now;
+  }
+
+  if (modeSwitched) {
+    startTransition(mode == UIMode::BT ? UI_TRANSITION_TO_BT : UI_TRANSITION_TO_DFP);
+  }
+
+  // While the transition runs it owns the frame budget; the new HUD follows
+  // on the first frame after the skin is complete.
+  if (transition.active) {
+    if (stepTransition()) {
+      transition.active = false;
+      backgroundDrawn = true;
+      lastBackgroundRefresh = now;
+      lastBatteryRefresh = 0;
+      hudNeedsRestore = true;
+    }
+    rememberFrame(audio, battery, mode, minuteTick, timeNow);
+    governorRecordFrame(display.bytesSent() - bytesBefore, now);
+    return;
   }
 
   if (mode == UIMode::DFP) {
-    bool warn = (battery.percent < UI_WARNING_THRESHOLD || battery.level == BatteryLevel::Red);
     if (batDiff || timeDiff || modeDiff || hudNeedsRestore) {
-      drawTopBar(battery, timeBuf, warn);
+      drawTopBar(battery, timeBuf, warnTint);
     }
 
-    if ((audioDiff || modeDiff || timeDiff || hudNeedsRestore) && (hudNeedsRestore || now - lastHudRefresh >= UI_HUD_REFRESH_MS)) {
+    if ((audioDiff || modeDiff || timeDiff || hudNeedsRestore) && (hudNeedsRestore || now - lastHudRefresh >= tier.hudRefreshMs)) {
       drawTrackPanel(audio, pulseActive);
       drawStatePanel(audio, pulseActive);
       drawMessagePanel(timeBuf);
       drawVolumePanel(audio);
-      drawEqBars(now);
+      if (tier.eqBars) drawEqBars(now);
       lastHudRefresh = now;
       hudNeedsRestore = false;
+      latencyMark(LatencyStage::Ui, micros());
     }
 
     if (batDiff || (now - lastBatteryRefresh >= UI_BATTERY_REFRESH_MS)) {
@@ -393,31 +739,35 @@ void uiUpdate(const AudioStatus &audio, const BatteryStatus &battery, UIMode mod
       lastBatteryRefresh = now;
     }
 
+    // Static spinner frames are drawn once; only the animation repaints periodically.
     bool spinning = (audio.state == PlaybackState::Playing) && audio.online;
-    if (spinning && (now - lastVinylStep > 90)) {
-      vinylAngle = (vinylAngle + 5) % 360;
-      drawVinylSpinner(true);
-      lastVinylStep = now;
-    } else if (!spinning) {
-      drawVinylSpinner(false);
+    if (spinning && tier.vinylStepMs > 0) {
+      if (now - lastVinylStep > tier.vinylStepMs) {
+        vinylAngle = (vinylAngle + 5) % 360;
+        drawVinylSpinner(true);
+        lastVinylStep = now;
+      }
+      spinnerStatic = -1;
+    } else if (spinnerStatic != (spinning ? 1 : 0)) {
+      drawVinylSpinner(spinning);
+      spinnerStatic = spinning ? 1 : 0;
     }
 
-    updateVolumeOverlay(audio, battery, timeNow, now);
+    updateOverlay(audio, battery, timeBuf, warnTint, now);
   } else {
-    if (batDiff || timeDiff || modeDiff) {
-      drawBtHud(battery, timeNow, now);
+    if (batDiff || timeDiff || modeDiff || hudNeedsRestore) {
+      drawBtHud(battery, timeNow);
+      hudNeedsRestore = false;
     }
-    if (now - lastBtAnim > 120) {
-      drawBtHud(battery, timeNow, now);
+    if (tier.btAnimMs > 0 && now - lastBtAnim > tier.btAnimMs) {
+      lastBtAnim = now;
+      btAnimPhase = (btAnimPhase + 1) % 10;
+      drawBtSweep();
     }
   }
 
-  uiCache.audio = audio;
-  uiCache.battery = battery;
-  uiCache.mode = mode;
-  uiCache.minuteTick = minuteTick;
-  uiCache.clock = timeNow;
-  uiCache.initialized = true;
+  rememberFrame(audio, battery, mode, minuteTick, timeNow);
+  governorRecordFrame(display.bytesSent() - bytesBefore, now);
 }
 
 void uiPulse(const char *label) {
@@ -426,9 +776,78 @@ void uiPulse(const char *label) {
 }
 
 void uiShowVolumeOverlay() {
+  if (overlayKind != OverlayKind::Volume) return;
   unsigned long now = millis();
-  volumeOverlayActive = true;
+  overlayActive = true;
   overlayPendingClear = false;
   volumeOverlayUntilMs = now + UI_VOLUME_OVERLAY_MS;
   overlayVolumeLerp = uiCache.initialized ? uiCache.audio.volume : DEFAULT_VOLUME;
 }
+
+static void showPanelOverlay(OverlayKind kind) {
+  overlayActive = true;
+  overlayPendingClear = false;
+  overlayKind = kind;
+  overlayDirty = true;
+}
+
+static void hidePanelOverlay(OverlayKind kind) {
+  if (overlayKind != kind) return;
+  overlayKind = OverlayKind::Volume;
+  overlayActive = false;
+  overlayPendingClear = true;
+}
+
+void uiShowSettings(SettingsField field) {
+  settingsShownField = field;
+  showPanelOverlay(OverlayKind::Settings);
+}
+
+void uiHideSettings() {
+  hidePanelOverlay(OverlayKind::Settings);
+}
+
+void uiShowDial() {
+  showPanelOverlay(OverlayKind::Dial);
+}
+
+void uiHideDial() {
+  hidePanelOverlay(OverlayKind::Dial);
+}
+
+void uiPanelSleep() {
+  enterPanelPower(PanelPower::Sleep, millis());
+}
+
+void uiPrintPowerStats(Print &out) {
+  static const char *const names[3] = {"normal", "idle", "sleep"};
+  unsigned long now = millis();
+  uint8_t current = static_cast<uint8_t>(display.power());
+  for (uint8_t i = 0; i < 3; ++i) {
+    uint32_t ms = panelPowerMs[i] + (i == current ? now - panelPowerSince : 0);
+    out.print(i == current ? '*' : ' ');
+    out.print(names[i]);
+    out.print(' ');
+    out.print(ms / 1000);
+    out.println("s");
+  }
+}
+
+void uiSetScanlines(bool enabled) {
+  scanlinesEnabled = enabled;
+}
+
+void uiPrintFxStats(Print &out) {
+  const PanelFxStats &stats = display.lineFxStats();
+  out.print("fx=0x");
+  out.print(display.lineFx(), 16);
+  out.print(" lines=");
+  out.print(stats.lines);
+  if (stats.lines > 0) {
+    out.print(" cycles/line=");
+    out.print(stats.cycles / stats.lines);
+    out.print(" cycles/px=");
+    out.print(static_cast<double>(stats.cycles) / stats.pixels, 2);
+  }
+  out.println();
+}
@@ -4,6 +4,7 @@
 #include "config.h"
 #include "audio.h"
 #include "power.h"
+#include "settings.h"
 
 struct ClockTime {
   uint8_t hour;
@@ -20,4 +21,15 @@ void uiInit();
 void uiUpdate(const AudioStatus &audio, const BatteryStatus &battery, UIMode mode, const ClockTime &timeNow);
 void uiPulse(const char *label);
 void uiShowVolumeOverlay();
+// Shows the settings selector on `field`; call again after every edit.
+void uiShowSettings(SettingsField field);
+void uiHideSettings();
+// Shows the track dial (dial.h); digit edits are picked up on the next frame.
+void uiShowDial();
+void uiHideDial();
+// Puts the panel to sleep now (sleep timer); the next input wakes it as usual.
+void uiPanelSleep();
+void uiPrintPowerStats(Print &out);
+void uiSetScanlines(bool enabled);
+void uiPrintFxStats(Print &out);
 
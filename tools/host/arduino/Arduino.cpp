@@ -0,0 +1,124 @@
+#include "Arduino.h"
+
+static uint64_t simNowUs = 0;
+static HostUartDevice *uartDevices[3] = {nullptr, nullptr, nullptr};
+static const int TX_FIFO_BYTES = 128;
+
+HardwareSerial Serial(0);
+
+unsigned long millis() {
+  return static_cast<unsigned long>(simNowUs / 1000);
+}
+
+unsigned long micros() {
+  return static_cast<unsigned long>(simNowUs);
+}
+
+void delay(uint32_t ms) {
+  simNowUs += static_cast<uint64_t>(ms) * 1000;
+}
+
+uint32_t esp_random() {
+  static uint32_t x = 0x12345678;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  return x;
+}
+
+uint64_t hostNowUs() {
+  return simNowUs;
+}
+
+void hostSetNowUs(uint64_t us) {
+  simNowUs = us;
+}
+
+void hostAttachUart(int port, HostUartDevice *device) {
+  if (port >= 0 && port < 3) uartDevices[port] = device;
+}
+
+size_t Print::write(const uint8_t *data, size_t len) {
+  size_t n = 0;
+  while (len--) n += write(*data++);
+  return n;
+}
+
+size_t Print::print(const char *s) {
+  return write(reinterpret_cast<const uint8_t *>(s), strlen(s));
+}
+
+size_t Print::print(char c) {
+  return write(static_cast<uint8_t>(c));
+}
+
+size_t Print::print(int v, int base) {
+  return print(static_cast<long>(v), base);
+}
+
+size_t Print::print(unsigned v, int base) {
+  return print(static_cast<unsigned long>(v), base);
+}
+
+size_t Print::print(long v, int base) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == 16 ? "%lx" : "%ld", v);
+  return print(buf);
+}
+
+size_t Print::print(unsigned long v, int base) {
+  char buf[24];
+  snprintf(buf, sizeof(buf), base == 16 ? "%lx" : "%lu", v);
+  return print(buf);
+}
+
+size_t Print::print(double v, int digits) {
+  char buf[32];
+  snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return print(buf);
+}
+
+size_t Print::println() {
+  return print("\n");
+}
+
+size_t Print::println(const char *s) {
+  return print(s) + println();
+}
+
+void HardwareSerial::begin(unsigned long baud, uint32_t, int8_t, int8_t) {
+  baudRate = baud;
+}
+
+int HardwareSerial::available() {
+  HostUartDevice *dev = uartDevices[port];
+  return dev ? dev->hostAvailable(simNowUs) : 0;
+}
+
+int HardwareSerial::read() {
+  HostUartDevice *dev = uartDevices[port];
+  return dev ? dev->hostRead(simNowUs) : -1;
+}
+
+int HardwareSerial::availableForWrite() {
+  uint64_t byteUs = 10000000ULL / baudRate;
+  uint64_t queued = txBusyUntil > simNowUs ? (txBusyUntil - simNowUs + byteUs - 1) / byteUs : 0;
+  return TX_FIFO_BYTES - static_cast<int>(std::min<uint64_t>(queued, TX_FIFO_BYTES));
+}
+
+size_t HardwareSerial::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t len) {
+  HostUartDevice *dev = uartDevices[port];
+  if (!dev) {
+    fwrite(data, 1, len, stdout);
+    return len;
+  }
+  uint64_t byteUs = 10000000ULL / baudRate;
+  uint64_t start = std::max(txBusyUntil, simNowUs);
+  dev->hostWrite(data, len, start);
+  txBusyUntil = start + byteUs * len;
+  return len;
+}
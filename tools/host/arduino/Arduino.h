@@ -0,0 +1,81 @@
+#pragma once
+
+// Minimal Arduino core for compiling firmware modules on the host. Time is a
+// simulated clock advanced by the harness; HardwareSerial ports are wired to
+// HostUartDevice instances (e.g. the DFPlayer emulator).
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+using std::max;
+using std::min;
+
+#define PROGMEM
+#define IRAM_ATTR
+#define SERIAL_8N1 0x800001c
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+typedef bool boolean;
+
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+uint32_t esp_random();
+
+uint64_t hostNowUs();
+void hostSetNowUs(uint64_t us);
+
+class Print {
+ public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t b) = 0;
+  virtual size_t write(const uint8_t *data, size_t len);
+  size_t print(const char *s);
+  size_t print(char c);
+  size_t print(int v, int base = 10);
+  size_t print(unsigned v, int base = 10);
+  size_t print(long v, int base = 10);
+  size_t print(unsigned long v, int base = 10);
+  size_t print(double v, int digits = 2);
+  size_t println();
+  size_t println(const char *s);
+  template <typename T>
+  size_t println(T v) {
+    size_t n = print(v);
+    return n + println();
+  }
+};
+
+class HostUartDevice {
+ public:
+  virtual ~HostUartDevice() {}
+  virtual void hostWrite(const uint8_t *data, size_t len, uint64_t nowUs) = 0;
+  virtual int hostAvailable(uint64_t nowUs) = 0;
+  virtual int hostRead(uint64_t nowUs) = 0;
+};
+
+void hostAttachUart(int port, HostUartDevice *device);
+
+class HardwareSerial : public Print {
+ public:
+  explicit HardwareSerial(int uartPort) : port(uartPort) {}
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1);
+  int available();
+  int read();
+  int availableForWrite();
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t *data, size_t len) override;
+
+ private:
+  int port;
+  unsigned long baudRate = 115200;
+  uint64_t txBusyUntil = 0;
+};
+
+extern HardwareSerial Serial;
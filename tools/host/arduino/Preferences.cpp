@@ -0,0 +1,103 @@
+#include "Preferences.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+static std::map<std::string, std::vector<uint8_t>> store;
+static uint32_t writes = 0;
+
+static std::string fullKey(const char *ns, const char *key) {
+  return std::string(ns) + "/" + key;
+}
+
+bool Preferences::begin(const char *name, bool ro, const char *) {
+  snprintf(ns, sizeof(ns), "%s", name);
+  open = true;
+  readOnly = ro;
+  return true;
+}
+
+void Preferences::end() {
+  open = false;
+}
+
+bool Preferences::clear() {
+  if (!open || readOnly) return false;
+  std::string prefix = fullKey(ns, "");
+  for (auto it = store.begin(); it != store.end();) {
+    it = it->first.compare(0, prefix.size(), prefix) == 0 ? store.erase(it) : std::next(it);
+  }
+  writes++;
+  return true;
+}
+
+bool Preferences::remove(const char *key) {
+  if (!open || readOnly) return false;
+  writes++;
+  return store.erase(fullKey(ns, key)) > 0;
+}
+
+bool Preferences::isKey(const char *key) {
+  return open && store.count(fullKey(ns, key)) > 0;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  if (!open || readOnly) return 0;
+  const uint8_t *p = static_cast<const uint8_t *>(value);
+  store[fullKey(ns, key)].assign(p, p + len);
+  writes++;
+  return len;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t maxLen) {
+  auto it = store.find(fullKey(ns, key));
+  if (!open || it == store.end() || it->second.size() > maxLen) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  auto it = store.find(fullKey(ns, key));
+  return open && it != store.end() ? it->second.size() : 0;
+}
+
+uint32_t hostNvsWrites() {
+  return writes;
+}
+
+void hostNvsErase() {
+  store.clear();
+}
+
+// File format: per entry, key length, key, value length, value (uint32 lengths).
+bool hostNvsLoad(const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (!f) return false;
+  store.clear();
+  uint32_t keyLen, valueLen;
+  while (fread(&keyLen, sizeof(keyLen), 1, f) == 1) {
+    std::string key(keyLen, '\0');
+    std::vector<uint8_t> value;
+    if (fread(&key[0], 1, keyLen, f) != keyLen || fread(&valueLen, sizeof(valueLen), 1, f) != 1) break;
+    value.resize(valueLen);
+    if (fread(value.data(), 1, valueLen, f) != valueLen) break;
+    store[key] = value;
+  }
+  fclose(f);
+  return true;
+}
+
+bool hostNvsSave(const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (!f) return false;
+  for (const auto &entry : store) {
+    uint32_t keyLen = entry.first.size();
+    uint32_t valueLen = entry.second.size();
+    fwrite(&keyLen, sizeof(keyLen), 1, f);
+    fwrite(entry.first.data(), 1, keyLen, f);
+    fwrite(&valueLen, sizeof(valueLen), 1, f);
+    fwrite(entry.second.data(), 1, valueLen, f);
+  }
+  return fclose(f) == 0;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+// In-memory NVS for host builds. Namespaces live for the process unless saved
+// to a file and loaded by the next run; the write counter lets simulations
+// check how often the firmware commits.
+
+#include "Arduino.h"
+
+class Preferences {
+ public:
+  bool begin(const char *name, bool readOnly = false, const char *partition = nullptr);
+  void end();
+  bool clear();
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+  size_t putUChar(const char *key, uint8_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putUShort(const char *key, uint16_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putUInt(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putULong(const char *key, uint32_t value) { return putBytes(key, &value, sizeof(value)); }
+  size_t putBytes(const char *key, const void *value, size_t len);
+
+  uint8_t getUChar(const char *key, uint8_t fallback = 0) { return get(key, fallback); }
+  uint16_t getUShort(const char *key, uint16_t fallback = 0) { return get(key, fallback); }
+  uint32_t getUInt(const char *key, uint32_t fallback = 0) { return get(key, fallback); }
+  uint32_t getULong(const char *key, uint32_t fallback = 0) { return get(key, fallback); }
+  size_t getBytes(const char *key, void *buf, size_t maxLen);
+  size_t getBytesLength(const char *key);
+
+ private:
+  template <typename T>
+  T get(const char *key, T fallback) {
+    T v;
+    return getBytesLength(key) == sizeof(T) && getBytes(key, &v, sizeof(T)) == sizeof(T) ? v : fallback;
+  }
+
+  char ns[16] = "";
+  bool open = false;
+  bool readOnly = false;
+};
+
+uint32_t hostNvsWrites();
+void hostNvsErase();
+bool hostNvsLoad(const char *path);
+bool hostNvsSave(const char *path);
@@ -0,0 +1,10 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF error codes used by the other esp_* headers.
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_STATE 0x103
+#define ESP_ERR_INVALID_SIZE 0x104
@@ -0,0 +1,107 @@
+#include "esp_partition.h"
+
+#include <cstring>
+#include <string>
+#include <vector>
+
+static const uint32_t SECTOR = 4096;
+
+struct HostPartition {
+  esp_partition_t info;
+  std::vector<uint8_t> bytes;
+  std::vector<uint32_t> erases;
+};
+
+static std::vector<HostPartition *> partitions;
+static int cutAfterBytes = -1; // armed power cut
+static bool powerOff = false;
+
+static HostPartition *lookup(const esp_partition_t *p) {
+  for (HostPartition *h : partitions) {
+    if (&h->info == p) return h;
+  }
+  return nullptr;
+}
+
+void hostPartitionAdd(const char *label, uint32_t size) {
+  HostPartition *h = new HostPartition();
+  h->info.type = ESP_PARTITION_TYPE_DATA;
+  h->info.subtype = static_cast<esp_partition_subtype_t>(0x99);
+  h->info.address = 0;
+  h->info.size = size;
+  snprintf(h->info.label, sizeof(h->info.label), "%s", label);
+  h->bytes.assign(size, 0xFF);
+  h->erases.assign(size / SECTOR, 0);
+  partitions.push_back(h);
+}
+
+const uint32_t *hostPartitionErases(const char *label, uint16_t *sectors) {
+  for (HostPartition *h : partitions) {
+    if (strcmp(h->info.label, label) == 0) {
+      *sectors = h->erases.size();
+      return h->erases.data();
+    }
+  }
+  *sectors = 0;
+  return nullptr;
+}
+
+void hostPartitionCutPower(uint16_t bytes) {
+  cutAfterBytes = bytes;
+}
+
+void hostPartitionPowerOn() {
+  cutAfterBytes = -1;
+  powerOff = false;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label) {
+  for (HostPartition *h : partitions) {
+    if (h->info.type != type) continue;
+    if (subtype != ESP_PARTITION_SUBTYPE_ANY && h->info.subtype != subtype) continue;
+    if (label && strcmp(h->info.label, label) != 0) continue;
+    return &h->info;
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size) {
+  HostPartition *h = lookup(partition);
+  if (!h) return ESP_ERR_INVALID_ARG;
+  if (src_offset + size > h->bytes.size()) return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, h->bytes.data() + src_offset, size);
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size) {
+  HostPartition *h = lookup(partition);
+  if (!h) return ESP_ERR_INVALID_ARG;
+  if (dst_offset + size > h->bytes.size()) return ESP_ERR_INVALID_SIZE;
+  if (powerOff) return ESP_OK;
+  if (cutAfterBytes >= 0) {
+    size = min<size_t>(size, cutAfterBytes);
+    cutAfterBytes = -1;
+    powerOff = true;
+  }
+  const uint8_t *in = static_cast<const uint8_t *>(src);
+  for (size_t i = 0; i < size; ++i) h->bytes[dst_offset + i] &= in[i];
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size) {
+  HostPartition *h = lookup(partition);
+  if (!h) return ESP_ERR_INVALID_ARG;
+  if (offset % SECTOR || size % SECTOR || offset + size > h->bytes.size()) return ESP_ERR_INVALID_SIZE;
+  if (powerOff) return ESP_OK;
+  for (size_t s = offset / SECTOR; s < (offset + size) / SECTOR; ++s) h->erases[s]++;
+  if (cutAfterBytes >= 0) {
+    // Erase stopped halfway: the start already reads 0xFF, the rest is unchanged.
+    cutAfterBytes = -1;
+    powerOff = true;
+    memset(h->bytes.data() + offset, 0xFF, size / 2);
+    return ESP_OK;
+  }
+  memset(h->bytes.data() + offset, 0xFF, size);
+  return ESP_OK;
+}
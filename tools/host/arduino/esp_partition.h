@@ -0,0 +1,35 @@
+#pragma once
+
+// Host stand-in for the ESP-IDF partition API. Partitions are RAM buffers
+// with NOR semantics: writes can only clear bits and erase sets whole 4 KB
+// sectors back to 0xFF. Simulations register partitions by label, count
+// erases per sector and can cut the power in the middle of a write.
+
+#include "Arduino.h"
+#include "esp_err.h"
+
+typedef enum { ESP_PARTITION_TYPE_APP = 0x00, ESP_PARTITION_TYPE_DATA = 0x01 } esp_partition_type_t;
+typedef enum { ESP_PARTITION_SUBTYPE_ANY = 0xff } esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+} esp_partition_t;
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char *label);
+esp_err_t esp_partition_read(const esp_partition_t *partition, size_t src_offset, void *dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t *partition, size_t dst_offset, const void *src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t *partition, size_t offset, size_t size);
+
+void hostPartitionAdd(const char *label, uint32_t size);
+// Erase count of every sector of the partition, in order.
+const uint32_t *hostPartitionErases(const char *label, uint16_t *sectors);
+// Power cut: the next write lands only its first `bytes` bytes, or the next
+// erase stops halfway, and from then on writes and erases are lost until
+// hostPartitionPowerOn(). The firmware is not told, just as on a real cut.
+void hostPartitionCutPower(uint16_t bytes);
+void hostPartitionPowerOn();
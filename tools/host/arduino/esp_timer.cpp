@@ -0,0 +1,43 @@
+#include "esp_timer.h"
+
+#include <vector>
+
+struct HostEspTimer {
+  esp_timer_create_args_t args;
+  bool running;
+  uint64_t dueUs;
+};
+
+static std::vector<HostEspTimer *> timers;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out) {
+  HostEspTimer *t = new HostEspTimer{*args, false, 0};
+  timers.push_back(t);
+  *out = t;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs) {
+  if (timer->running) return ESP_ERR_INVALID_STATE;
+  timer->running = true;
+  timer->dueUs = esp_timer_get_time() + timeoutUs;
+  return ESP_OK;
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t timer) {
+  if (!timer->running) return ESP_ERR_INVALID_STATE;
+  timer->running = false;
+  return ESP_OK;
+}
+
+int64_t esp_timer_get_time() {
+  return static_cast<int64_t>(micros());
+}
+
+void hostEspTimerService(uint64_t nowUs) {
+  for (HostEspTimer *t : timers) {
+    if (!t->running || nowUs < t->dueUs) continue;
+    t->running = false;
+    t->args.callback(t->args.arg);
+  }
+}
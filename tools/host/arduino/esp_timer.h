@@ -0,0 +1,26 @@
+#pragma once
+
+// Host stand-in for ESP-IDF one-shot timers on the simulated clock. Nothing
+// fires on its own: the simulation calls hostEspTimerService() as it
+// advances time, and due callbacks run from there.
+
+#include "Arduino.h"
+#include "esp_err.h"
+
+typedef struct HostEspTimer *esp_timer_handle_t;
+typedef void (*esp_timer_cb_t)(void *arg);
+
+typedef struct {
+  esp_timer_cb_t callback;
+  void *arg;
+  int dispatch_method;
+  const char *name;
+  bool skip_unhandled_events;
+} esp_timer_create_args_t;
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out);
+esp_err_t esp_timer_start_once(esp_timer_handle_t timer, uint64_t timeoutUs);
+esp_err_t esp_timer_stop(esp_timer_handle_t timer);
+int64_t esp_timer_get_time();
+
+void hostEspTimerService(uint64_t nowUs);
@@ -0,0 +1,279 @@
+// Runs firmware/audio.cpp and firmware/dfplayer.cpp against the DFPlayer
+// emulator on a simulated clock. Prints the wire traffic of a scripted
+// session, link statistics and a codec throughput figure. Build: see README.md.
+//
+// With a file argument, NVS is loaded from it before boot and saved back at
+// the end, so a second run boots the way a device does after a power cycle.
+
+#include <Arduino.h>
+
+#include <Preferences.h>
+#include <esp_partition.h>
+#include <esp_timer.h>
+
+#include <chrono>
+
+#include "../../firmware/audio.h"
+#include "../../firmware/dfplayer.h"
+#include "../../firmware/dial.h"
+#include "../../firmware/latency.h"
+#include "../../firmware/playlist.h"
+#include "../../firmware/resume.h"
+#include "../../firmware/settings.h"
+#include "../../firmware/sleeptimer.h"
+#include "../../firmware/trackstats.h"
+#include "dfplayer_emu.h"
+
+// UART1 as the firmware sees it. Taps both directions with a frame parser so
+// every frame on the wire can be logged and acks matched to their command.
+class EmuUart : public HostUartDevice {
+ public:
+  explicit EmuUart(DfPlayerEmulator &module) : emu(module) {}
+
+  void hostWrite(const uint8_t *data, size_t len, uint64_t nowUs) override {
+    if (connected) emu.hostWrite(data, len, nowUs);
+    uint64_t endUs = nowUs + len * DfPlayerEmulator::BYTE_US;
+    for (size_t i = 0; i < len; ++i) {
+      if (txTap.push(data[i])) logFrame(">>", txTap.frame(), nowUs);
+    }
+    if (txTap.frame().feedback) {
+      awaitingAck = true;
+      sentAt = endUs;
+    }
+  }
+
+  int hostAvailable(uint64_t nowUs) override {
+    if (!connected) return 0;
+    emu.advance(nowUs);
+    return emu.hostAvailable(nowUs);
+  }
+
+  int hostRead(uint64_t nowUs) override {
+    int b = emu.hostRead(nowUs);
+    if (b >= 0 && rxTap.push(static_cast<uint8_t>(b))) {
+      const DfFrame &f = rxTap.frame();
+      logFrame("<<", f, nowUs);
+      if (f.command == DfMsg::Ack && awaitingAck) {
+        uint64_t latency = nowUs - sentAt;
+        ackTotalUs += latency;
+        ackMaxUs = std::max(ackMaxUs, latency);
+        acks++;
+        awaitingAck = false;
+      }
+    }
+    return b;
+  }
+
+  bool verbose = true;
+  bool connected = true; // false: module unplugged, both wires dead
+  uint32_t acks = 0;
+  uint64_t ackTotalUs = 0;
+  uint64_t ackMaxUs = 0;
+
+ private:
+  void logFrame(const char *dir, const DfFrame &f, uint64_t atUs) {
+    if (!verbose) return;
+    printf("%9.3f ms %s cmd=0x%02X fb=%d param=%u\n", atUs / 1000.0, dir, f.command, f.feedback ? 1 : 0, f.param);
+  }
+
+  DfPlayerEmulator &emu;
+  DfFrameParser txTap;
+  DfFrameParser rxTap;
+  bool awaitingAck = false;
+  uint64_t sentAt = 0;
+};
+
+static DfPlayerEmulator *module = nullptr;
+static EmuUart *moduleUart = nullptr;
+
+static uint64_t nowUs() {
+  return static_cast<uint64_t>(millis()) * 1000;
+}
+
+// A touch as input.cpp would report it: edge, debounce, accept. The loop
+// below marks dispatch once the step's action has run.
+static void tap() {
+  uint64_t us = nowUs();
+  latencyBegin(us - (DEBOUNCE_MS + 1) * 1000UL, us);
+}
+
+struct Step {
+  uint32_t atMs;
+  const char *name;
+  void (*action)();
+};
+
+static const Step SCRIPT[] = {
+    {1800, "sleep 1", [] { sleepTimerSet(1); }},
+    {2500, "next", [] { tap(); audioNext(); }},
+    {2600, "next", [] { tap(); audioNext(); }},
+    {2700, "next", [] { tap(); audioNext(); }},
+    {3000, "vol+", [] { tap(); audioVolumeUp(); }},
+    {3010, "vol+", [] { tap(); audioVolumeUp(); }},
+    {3020, "vol+", [] { tap(); audioVolumeUp(); }},
+    {3500, "pause", [] { tap(); audioTogglePause(); }},
+    {4500, "resume", [] { tap(); audioTogglePause(); }},
+    {5000, "prev", [] { tap(); audioPrev(); }},
+    {6000, "shuffle", [] { audioSetShuffle(ShuffleMode::Plain); }},
+    {6500, "next", [] { tap(); audioNext(); }},
+    {7000, "next", [] { tap(); audioNext(); }},
+    {7500, "prev", [] { tap(); audioPrev(); }},
+    {7700, "smart shuffle", [] { audioSetShuffle(ShuffleMode::Smart); }},
+    {7850, "next", [] { tap(); audioNext(); }},
+    {8000, "album", [] { tap(); audioNextFolder(); }},
+    {8500, "shuffle off", [] { audioSetShuffle(ShuffleMode::Off); }},
+    {8600, "queue 30, play next 5", [] {
+       playlistEnqueue(30);
+       playlistPlayNext(5);
+     }},
+    {9000, "next", [] { tap(); audioNext(); }},
+    {9400, "next", [] { tap(); audioNext(); }},
+    {9800, "prev", [] { tap(); audioPrev(); }},
+    {10200, "list 40 2 7, save 1", [] {
+       playlistAppend(40);
+       playlistAppend(2);
+       playlistAppend(7);
+       playlistSave(1);
+       playlistClear();
+     }},
+    {10600, "load 1", [] { audioPlaylistPlay(1); }},
+    {11000, "next", [] { tap(); audioNext(); }},
+    {11400, "next", [] { tap(); audioNext(); }},
+    {11800, "next", [] { tap(); audioNext(); }},
+    {12000, "unplug", [] { moduleUart->connected = false; }},
+    {24000, "replug", [] {
+       module->powerCycle(nowUs());
+       moduleUart->connected = true;
+     }},
+    {32000, "card out", [] { module->setCardPresent(false, nowUs()); }},
+    {34000, "card in", [] { module->setCardPresent(true, nowUs()); }},
+    // Settings selector: five taps through the EQ presets, then headphones.
+    {36000, "eq +", [] { tap(); if (settingsStep(SettingsField::Eq, 1)) audioSettingsChanged(); }},
+    {36150, "eq +", [] { tap(); if (settingsStep(SettingsField::Eq, 1)) audioSettingsChanged(); }},
+    {36300, "eq +", [] { tap(); if (settingsStep(SettingsField::Eq, 1)) audioSettingsChanged(); }},
+    {36450, "eq +", [] { tap(); if (settingsStep(SettingsField::Eq, 1)) audioSettingsChanged(); }},
+    {36600, "eq +", [] { tap(); if (settingsStep(SettingsField::Eq, 1)) audioSettingsChanged(); }},
+    {37500, "out phones, close", [] {
+       if (settingsStep(SettingsField::Output, 1)) audioSettingsChanged();
+       settingsSave();
+     }},
+    // Track dial: 07 -> 23 with two digit edits, then one play on confirm.
+    {38000, "dial open", [] { dialBegin(getAudioStatus().track, getAudioStatus().trackCount); }},
+    {38200, "dial <, +2, >, -4", [] {
+       dialMove(-1);
+       dialStep(2);
+       dialMove(1);
+       dialStep(-4);
+     }},
+    {38500, "dial confirm", [] { tap(); audioJumpTo(dialValue()); }},
+    // Mark the dialled track, skip away, then play the favourites list.
+    {38800, "favourite", [] { tap(); audioToggleFavorite(); }},
+    {39000, "next", [] { tap(); audioNext(); }},
+    {39300, "pl fav", [] { audioPlayStats(true); }},
+    // The module drifts away from the model without saying so.
+    {41000, "module volume glitch", [] { module->forceVolume(4); }},
+    {44000, "module loses next 0x3D", [] { module->dropNextFinish(); }},
+    {58000, "dial 5", [] { tap(); audioJumpTo(5); }},
+    // The sleep timer fires at 61800 and fades out over SLEEP_FADE_MS.
+    {88000, "touch while asleep", [] { audioTogglePause(); }},
+};
+
+// What SPECTRA.ino does each loop for the resume store.
+static void noteResume(unsigned long now) {
+  ResumeState rs{};
+  audioSnapshot(rs);
+  resumeUpdate(rs, getAudioStatus().state == PlaybackState::Playing, now);
+}
+
+static void runSession(uint32_t durationMs) {
+  DfEmuConfig cfg;
+  // Album folders with a gap at 04, as a real card tends to have.
+  cfg.folderFiles[1] = 12;
+  cfg.folderFiles[2] = 9;
+  cfg.folderFiles[3] = 15;
+  cfg.folderFiles[5] = 4;
+  cfg.trackMs = 8000;
+  cfg.trackMsSpread = 2000;
+  DfPlayerEmulator emu(cfg);
+  EmuUart uart(emu);
+  module = &emu;
+  moduleUart = &uart;
+  hostAttachUart(1, &uart);
+  hostSetNowUs(0);
+
+  resumeBegin();
+  audioInit();
+  sleepTimerBegin();
+  bool sleepFading = false;
+  size_t next = 0;
+  for (uint32_t ms = 0; ms < durationMs; ++ms) {
+    hostSetNowUs(static_cast<uint64_t>(ms) * 1000);
+    while (next < sizeof(SCRIPT) / sizeof(SCRIPT[0]) && SCRIPT[next].atMs <= ms) {
+      printf("%9.3f ms -- %s\n", ms * 1.0, SCRIPT[next].name);
+      SCRIPT[next].action();
+      latencyMark(LatencyStage::Dispatch, nowUs());
+      next++;
+    }
+    audioLoop();
+    // What SPECTRA.ino does with the sleep timer, minus the panel and CPU.
+    hostEspTimerService(nowUs());
+    if (sleepTimerExpired()) {
+      printf("%9.3f ms -- sleep timer: fade out and pause\n", ms * 1.0);
+      sleepFading = audioFadeToPause(SLEEP_FADE_MS);
+    }
+    if (sleepFading && audioQuiet()) {
+      printf("%9.3f ms -- quiet, light sleep\n", ms * 1.0);
+      sleepFading = false;
+    }
+    noteResume(ms);
+  }
+
+  AudioStatus st = getAudioStatus();
+  printf("\nfirmware: track=%u/%u (%02u/%03u) volume=%u online=%d\n", st.track, st.trackCount, st.folder, st.file,
+         st.volume, st.online ? 1 : 0);
+  printf("module:   track=%u volume=%u eq=%u status=%u\n", emu.playingTrack(), emu.volume(), emu.eqPreset(),
+         static_cast<unsigned>(emu.status()));
+  const DfEmuStats &es = emu.stats();
+  printf("module:   framesIn=%u framesOut=%u errors=%u started=%u finished=%u\n", es.framesIn, es.framesOut,
+         es.errorsOut, es.tracksStarted, es.tracksFinished);
+  if (uart.acks) {
+    printf("ack latency: avg=%.2f ms max=%.2f ms over %u acks\n", uart.ackTotalUs / 1000.0 / uart.acks,
+           uart.ackMaxUs / 1000.0, uart.acks);
+  }
+  audioPrintStats(Serial);
+  resumePrintStats(Serial);
+  latencyPrintStats(Serial);
+  printf("nvs writes: %u\n", hostNvsWrites());
+  hostAttachUart(1, nullptr);
+}
+
+static void benchCodec() {
+  const uint32_t N = 2000000;
+  uint8_t frame[DF_FRAME_LEN];
+  DfFrameParser parser;
+  uint32_t parsed = 0;
+  uint32_t check = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < N; ++i) {
+    dfFrameEncode(frame, static_cast<uint8_t>(i & 0x4F), static_cast<uint16_t>(i), i & 1);
+    for (uint8_t b = 0; b < DF_FRAME_LEN; ++b) {
+      if (parser.push(frame[b])) {
+        parsed++;
+        check += parser.frame().param;
+      }
+    }
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / N;
+  printf("\ncodec: %u/%u frames round-tripped, %.1f ns per encode+parse (check %u)\n", parsed, N, ns, check);
+}
+
+int main(int argc, char **argv) {
+  const char *nvsPath = argc > 1 ? argv[1] : nullptr;
+  if (nvsPath) printf("nvs: %s\n", hostNvsLoad(nvsPath) ? "loaded" : "empty");
+  hostPartitionAdd("trkstats", 0x10000); // as in firmware/partitions.csv
+  runSession(90000);
+  if (nvsPath) hostNvsSave(nvsPath);
+  benchCodec();
+  return 0;
+}
@@ -0,0 +1,240 @@
+#include "dfplayer_emu.h"
+
+#include <algorithm>
+
+DfPlayerEmulator::DfPlayerEmulator(const DfEmuConfig &config) : cfg(config) {
+  powerCycle(0);
+}
+
+void DfPlayerEmulator::powerCycle(uint64_t nowUs) {
+  rxBytes.clear();
+  txBytes.clear();
+  pending.clear();
+  parser.reset();
+  state = DfEmuStatus::Stopped;
+  currentIndex = 0;
+  booted = false;
+  bootedAt = nowUs + cfg.bootUs;
+  txFreeAt = nowUs;
+  vol = 20;
+  eq = 0;
+  pending.push_back({bootedAt, DfMsg::InitDone, static_cast<uint16_t>(cfg.cardPresent ? 0x02 : 0x00)});
+}
+
+void DfPlayerEmulator::setCardPresent(bool present, uint64_t nowUs) {
+  if (present == cfg.cardPresent) return;
+  cfg.cardPresent = present;
+  if (!present) state = DfEmuStatus::Stopped;
+  emitFrame(present ? DfMsg::CardInserted : DfMsg::CardRemoved, 0x02, nowUs);
+}
+
+uint16_t DfPlayerEmulator::totalFiles() const {
+  uint32_t total = cfg.mp3Files;
+  for (uint8_t f = 1; f < 100; ++f) total += cfg.folderFiles[f];
+  return static_cast<uint16_t>(std::min<uint32_t>(total, 0xFFFF));
+}
+
+uint32_t DfPlayerEmulator::trackDurationMs(uint16_t index) const {
+  if (cfg.trackMsSpread == 0) return cfg.trackMs;
+  return cfg.trackMs + (static_cast<uint32_t>(index) * 7919u) % cfg.trackMsSpread;
+}
+
+uint16_t DfPlayerEmulator::indexOfFolderFile(uint8_t folder, uint16_t file) const {
+  if (folder < 1 || folder > 99 || file < 1 || file > cfg.folderFiles[folder]) return 0;
+  uint32_t index = 0;
+  for (uint8_t f = 1; f < folder; ++f) index += cfg.folderFiles[f];
+  return static_cast<uint16_t>(index + file);
+}
+
+uint16_t DfPlayerEmulator::indexOfMp3(uint16_t file) const {
+  if (file < 1 || file > cfg.mp3Files) return 0;
+  return static_cast<uint16_t>(totalFiles() - cfg.mp3Files + file);
+}
+
+void DfPlayerEmulator::emitFrame(uint8_t command, uint16_t param, uint64_t atUs) {
+  uint8_t frame[DF_FRAME_LEN];
+  dfFrameEncode(frame, command, param, false);
+  uint64_t t = std::max(atUs, txFreeAt);
+  for (uint8_t i = 0; i < DF_FRAME_LEN; ++i) {
+    t += BYTE_US;
+    txBytes.push_back({t, frame[i]});
+  }
+  txFreeAt = t;
+  counters.framesOut++;
+}
+
+void DfPlayerEmulator::reply(uint8_t command, uint16_t param, uint64_t atUs) {
+  pending.push_back({atUs, command, param});
+}
+
+void DfPlayerEmulator::error(uint8_t code, uint64_t nowUs) {
+  counters.errorsOut++;
+  reply(DfMsg::Error, code, nowUs + cfg.ackDelayUs);
+}
+
+bool DfPlayerEmulator::startTrack(uint16_t index, uint64_t nowUs) {
+  if (index == 0) return false;
+  currentIndex = index;
+  state = DfEmuStatus::Playing;
+  trackEndsAt = nowUs + static_cast<uint64_t>(trackDurationMs(index)) * 1000;
+  busyUntil = nowUs + cfg.busyAfterPlayUs;
+  counters.tracksStarted++;
+  return true;
+}
+
+void DfPlayerEmulator::hostWrite(const uint8_t *data, size_t len, uint64_t nowUs) {
+  uint64_t t = nowUs;
+  for (size_t i = 0; i < len; ++i) {
+    t += BYTE_US;
+    rxBytes.push_back({t, data[i]});
+  }
+}
+
+int DfPlayerEmulator::hostAvailable(uint64_t nowUs) const {
+  int n = 0;
+  for (const Byte &b : txBytes) {
+    if (b.at > nowUs) break;
+    n++;
+  }
+  return n;
+}
+
+int DfPlayerEmulator::hostRead(uint64_t nowUs) {
+  if (txBytes.empty() || txBytes.front().at > nowUs) return -1;
+  uint8_t v = txBytes.front().value;
+  txBytes.pop_front();
+  return v;
+}
+
+void DfPlayerEmulator::handleFrame(const DfFrame &frame, uint64_t nowUs) {
+  counters.framesIn++;
+  if (!booted) return; // the real module ignores the UART until it has booted
+  if (nowUs < busyUntil && frame.command != DfCmd::Reset) {
+    error(DfError::Busy, nowUs);
+    return;
+  }
+  if (!cfg.cardPresent && !dfIsQuery(frame.command) && frame.command != DfCmd::Reset &&
+      frame.command != DfCmd::SetVolume && frame.command != DfCmd::SetEq) {
+    error(DfError::CardFailure, nowUs);
+    return;
+  }
+
+  bool ok = true;
+  uint16_t total = totalFiles();
+  switch (frame.command) {
+    case DfCmd::Next:
+      ok = startTrack(currentIndex >= total ? 1 : currentIndex + 1, nowUs);
+      break;
+    case DfCmd::Prev:
+      ok = startTrack(currentIndex <= 1 ? total : currentIndex - 1, nowUs);
+      break;
+    case DfCmd::PlayTrack:
+      ok = frame.param >= 1 && frame.param <= total && startTrack(frame.param, nowUs);
+      break;
+    case DfCmd::PlayFolder:
+      ok = startTrack(indexOfFolderFile(frame.param >> 8, frame.param & 0xFF), nowUs);
+      break;
+    case DfCmd::PlayMp3Folder:
+      ok = startTrack(indexOfMp3(frame.param), nowUs);
+      break;
+    case DfCmd::SetVolume:
+      vol = static_cast<uint8_t>(std::min<uint16_t>(frame.param, 30));
+      break;
+    case DfCmd::SetEq:
+      eq = static_cast<uint8_t>(std::min<uint16_t>(frame.param, 5));
+      break;
+    case DfCmd::Pause:
+      if (state == DfEmuStatus::Playing) {
+        remainingUs = trackEndsAt > nowUs ? trackEndsAt - nowUs : 0;
+        state = DfEmuStatus::Paused;
+      }
+      break;
+    case DfCmd::Resume:
+      if (state == DfEmuStatus::Paused) {
+        trackEndsAt = nowUs + remainingUs;
+        state = DfEmuStatus::Playing;
+      } else if (state == DfEmuStatus::Stopped && currentIndex) {
+        startTrack(currentIndex, nowUs);
+      }
+      break;
+    case DfCmd::Stop:
+      state = DfEmuStatus::Stopped;
+      break;
+    case DfCmd::Reset:
+      powerCycle(nowUs);
+      return;
+    case DfCmd::QueryStatus:
+      reply(DfCmd::QueryStatus, static_cast<uint16_t>(0x0200 | static_cast<uint8_t>(state)), nowUs + cfg.replyDelayUs);
+      return;
+    case DfCmd::QueryVolume:
+      reply(DfCmd::QueryVolume, vol, nowUs + cfg.replyDelayUs);
+      return;
+    case DfCmd::QueryEq:
+      reply(DfCmd::QueryEq, eq, nowUs + cfg.replyDelayUs);
+      return;
+    case DfCmd::QueryTfFiles:
+      reply(DfCmd::QueryTfFiles, cfg.cardPresent ? total : 0, nowUs + cfg.replyDelayUs);
+      return;
+    case DfCmd::QueryTfTrack:
+      reply(DfCmd::QueryTfTrack, currentIndex, nowUs + cfg.replyDelayUs);
+      return;
+    case DfCmd::QueryFolderFiles: {
+      uint8_t folder = static_cast<uint8_t>(frame.param);
+      if (folder < 1 || folder > 99 || cfg.folderFiles[folder] == 0) {
+        error(DfError::NotFound, nowUs);
+      } else {
+        reply(DfCmd::QueryFolderFiles, cfg.folderFiles[folder], nowUs + cfg.replyDelayUs);
+      }
+      return;
+    }
+    case DfCmd::QueryFolders: {
+      uint16_t folders = 0;
+      for (uint8_t f = 1; f < 100; ++f) folders += cfg.folderFiles[f] ? 1 : 0;
+      reply(DfCmd::QueryFolders, folders, nowUs + cfg.replyDelayUs);
+      return;
+    }
+    default:
+      error(DfError::SerialError, nowUs);
+      return;
+  }
+
+  if (!ok) {
+    error(DfError::NotFound, nowUs);
+  } else if (frame.feedback) {
+    reply(DfMsg::Ack, 0, nowUs + cfg.ackDelayUs);
+  }
+}
+
+void DfPlayerEmulator::advance(uint64_t nowUs) {
+  while (!rxBytes.empty() && rxBytes.front().at <= nowUs) {
+    Byte b = rxBytes.front();
+    rxBytes.pop_front();
+    uint32_t errorsBefore = parser.errors();
+    if (parser.push(b.value)) {
+      handleFrame(parser.frame(), b.at);
+    } else if (parser.errors() != errorsBefore) {
+      counters.badFramesIn++;
+      if (booted) error(DfError::Checksum, b.at);
+    }
+  }
+
+  if (state == DfEmuStatus::Playing && nowUs >= trackEndsAt) {
+    state = DfEmuStatus::Stopped;
+    counters.tracksFinished++;
+    if (dropFinish) {
+      dropFinish = false;
+    } else {
+      reply(DfMsg::TfFinished, currentIndex, trackEndsAt);
+      reply(DfMsg::TfFinished, currentIndex, trackEndsAt + cfg.finishRepeatUs);
+    }
+  }
+
+  std::stable_sort(pending.begin(), pending.end(), [](const Pending &a, const Pending &b) { return a.at < b.at; });
+  size_t done = 0;
+  for (; done < pending.size() && pending[done].at <= nowUs; ++done) {
+    const Pending &p = pending[done];
+    if (p.command == DfMsg::InitDone) booted = true;
+    emitFrame(p.command, p.param, p.at);
+  }
+  pending.erase(pending.begin(), pending.begin() + done);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+// Host-side DFPlayer Mini emulator. It speaks the wire format from
+// firmware/dfplayer_frame.h at 9600 baud timing and models the parts of the
+// module the firmware depends on: SD layout, playback time, busy windows,
+// ack/reply latency and error replies.
+//
+// Track numbering for 0x03 (play by index) and 0x4C (current track) follows
+// the order folders 01..99 then /mp3, standing in for the FAT write order the
+// real module uses.
+
+#include <stdint.h>
+
+#include <deque>
+#include <vector>
+
+#include "../../firmware/dfplayer_frame.h"
+
+struct DfEmuConfig {
+  uint16_t folderFiles[100] = {0}; // [1..99] -> files in /NN/NNN.mp3
+  uint16_t mp3Files = 0;           // /mp3/NNNN.mp3
+  uint32_t trackMs = 180000;       // base duration; each file gets a stable offset
+  uint32_t trackMsSpread = 60000;  // 0 -> every file lasts exactly trackMs
+  uint32_t bootUs = 800000;        // power-on -> 0x3F
+  uint32_t ackDelayUs = 12000;     // frame received -> ack starts
+  uint32_t replyDelayUs = 25000;   // frame received -> query reply starts
+  uint32_t busyAfterPlayUs = 0;    // decoder spin-up; commands inside get Error(Busy)
+  uint32_t finishRepeatUs = 30000; // module repeats 0x3D once after this
+  bool cardPresent = true;
+};
+
+enum class DfEmuStatus : uint8_t {
+  Stopped = 0,
+  Playing = 1,
+  Paused = 2
+};
+
+struct DfEmuStats {
+  uint32_t framesIn;
+  uint32_t framesOut;
+  uint32_t errorsOut;
+  uint32_t badFramesIn;
+  uint32_t tracksStarted;
+  uint32_t tracksFinished;
+};
+
+class DfPlayerEmulator {
+ public:
+  explicit DfPlayerEmulator(const DfEmuConfig &config);
+
+  // Bytes written by the host UART at `nowUs`; they arrive one bit-time apart.
+  void hostWrite(const uint8_t *data, size_t len, uint64_t nowUs);
+  // Bytes the host UART can read at `nowUs`.
+  int hostAvailable(uint64_t nowUs) const;
+  int hostRead(uint64_t nowUs);
+  // Run timers (track end, delayed replies) up to `nowUs`.
+  void advance(uint64_t nowUs);
+
+  void powerCycle(uint64_t nowUs);
+  void setCardPresent(bool present, uint64_t nowUs);
+  // Faults the host is not told about: the volume changes on its own, and
+  // the next track end is not reported.
+  void forceVolume(uint8_t level) { vol = level; }
+  void dropNextFinish() { dropFinish = true; }
+
+  DfEmuStatus status() const { return state; }
+  uint16_t playingTrack() const { return currentIndex; }
+  uint8_t volume() const { return vol; }
+  uint8_t eqPreset() const { return eq; }
+  uint32_t trackDurationMs(uint16_t index) const;
+  uint16_t totalFiles() const;
+  const DfEmuStats &stats() const { return counters; }
+
+  static const uint32_t BYTE_US = 1042; // 10 bits at 9600 baud
+
+ private:
+  struct Pending {
+    uint64_t at;
+    uint8_t command;
+    uint16_t param;
+  };
+  struct Byte {
+    uint64_t at;
+    uint8_t value;
+  };
+
+  void handleFrame(const DfFrame &frame, uint64_t nowUs);
+  void reply(uint8_t command, uint16_t param, uint64_t atUs);
+  void error(uint8_t code, uint64_t nowUs);
+  bool startTrack(uint16_t index, uint64_t nowUs);
+  uint16_t indexOfFolderFile(uint8_t folder, uint16_t file) const;
+  uint16_t indexOfMp3(uint16_t file) const;
+  void emitFrame(uint8_t command, uint16_t param, uint64_t atUs);
+
+  DfEmuConfig cfg;
+  DfFrameParser parser;
+  std::deque<Byte> rxBytes;  // host -> module, not yet parsed
+  std::deque<Byte> txBytes;  // module -> host
+  std::vector<Pending> pending;
+  uint64_t txFreeAt = 0;
+  uint64_t bootedAt = 0;
+  bool booted = false;
+
+  DfEmuStatus state = DfEmuStatus::Stopped;
+  uint16_t currentIndex = 0;
+  uint64_t trackEndsAt = 0;   // valid while Playing
+  uint64_t remainingUs = 0;   // valid while Paused
+  uint64_t busyUntil = 0;
+  uint8_t vol = 20;
+  uint8_t eq = 0;
+  bool dropFinish = false;
+  DfEmuStats counters{};
+};
@@ -0,0 +1,340 @@
+// Runs the playback engine (firmware/audio.cpp) on SimBackend. First the
+// sleep timer's fade-out is run at several volumes: the module must end up
+// paused at volume 0 without a single queue entry dropped on the way. Skips
+// on a module that acks quickly, where the fades around a track change take
+// the most entries, must likewise leave it at the user's volume, and a skip
+// burst that ends where it started must leave the track's stats alone.
+// Then hours of simulated time pass in which a random listener skips,
+// pauses, changes volume, jumps, shuffles and switches to BT and back, while
+// the module now and then changes its volume or drops a track-end report
+// behind the engine's back. Whenever the link is quiet the engine's model is
+// checked against the module's own state; a difference that outlives the
+// next second counts as a fault. Then reports the time per audioLoop() and
+// the UART frames per hour of a settled player. Build: see README.md.
+
+#include <Arduino.h>
+
+#include <Preferences.h>
+#include <esp_partition.h>
+
+#include <chrono>
+
+#include "../../firmware/audio.h"
+#include "../../firmware/playlist.h"
+#include "../../firmware/resume.h"
+#include "../../firmware/trackstats.h"
+#include "sim_backend.h"
+
+static uint32_t rng = 0x5EC7A;
+
+static uint32_t random32() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static uint32_t randomBelow(uint32_t n) {
+  return random32() % n;
+}
+
+struct Checks {
+  uint32_t made;
+  uint32_t differed;   // at one sample
+  uint32_t persistent; // still different a second later
+  uint32_t volumeFaults;
+  uint32_t volumeHealed;
+  uint32_t finishFaults;
+  uint32_t worstHealMs;
+};
+
+static Checks checks{};
+static uint32_t failures = 0;
+static uint32_t loops = 0;
+static double loopNs = 0;
+
+static const char *describe(const SimModuleState &m, const AudioStatus &st) {
+  static char buf[128];
+  snprintf(buf, sizeof(buf), "engine %u (%02u/%03u) state=%d vol=%u, module %u status=%u vol=%u", st.track, st.folder,
+           st.file, static_cast<int>(st.state), st.volume, m.index, m.status, m.volume);
+  return buf;
+}
+
+// Whether the module is doing what the engine thinks it is.
+static bool agrees(const SimModuleState &m, const AudioStatus &st) {
+  switch (st.state) {
+    case PlaybackState::Playing:
+      return m.status == 1 && m.volume == st.volume && m.index == SimBackend::indexOfFolderFile(st.folder, st.file);
+    case PlaybackState::Paused:
+      return m.status == 2 && m.index == SimBackend::indexOfFolderFile(st.folder, st.file);
+    default:
+      return m.status != 1;
+  }
+}
+
+// What SPECTRA.ino does each loop besides input and the screen.
+static void step(unsigned long ms) {
+  hostSetNowUs(static_cast<uint64_t>(ms) * 1000);
+  auto t0 = std::chrono::steady_clock::now();
+  audioLoop();
+  auto t1 = std::chrono::steady_clock::now();
+  loopNs += std::chrono::duration<double, std::nano>(t1 - t0).count();
+  loops++;
+  ResumeState rs{};
+  audioSnapshot(rs);
+  resumeUpdate(rs, getAudioStatus().state == PlaybackState::Playing, ms);
+}
+
+// The live link's counters. audioPrintStats() reports whichever backend the
+// engine is on, which is NullBackend in BT mode.
+static void printLink(const char *when) {
+  const DfStats &s = SimBackend::stats();
+  printf("link %s: queued=%u sent=%u dropped=%u cancelled=%u acks=%u timeouts=%u rx=%u\n", when, s.queued, s.sent,
+         s.dropped, s.cancelled, s.acks, s.timeouts, s.rxFrames);
+}
+
+static unsigned long runFor(unsigned long from, uint32_t durationMs) {
+  for (unsigned long ms = from; ms < from + durationMs; ++ms) step(ms);
+  return from + durationMs;
+}
+
+static void setVolume(uint8_t level) {
+  while (getAudioStatus().volume < level && audioVolumeUp()) {
+  }
+  while (getAudioStatus().volume > level && audioVolumeDown()) {
+  }
+}
+
+// What SPECTRA.ino does when the sleep timer expires, from a playing track.
+static unsigned long checkSleepFades(unsigned long ms) {
+  static const uint8_t LEVELS[] = {20, 25, 30};
+  for (uint8_t level : LEVELS) {
+    setVolume(level);
+    if (getAudioStatus().state != PlaybackState::Playing) audioTogglePause();
+    ms = runFor(ms, 3000);
+    uint32_t droppedBefore = SimBackend::stats().dropped;
+    bool started = audioFadeToPause(SLEEP_FADE_MS);
+    ms = runFor(ms, SLEEP_FADE_MS + 2000);
+    SimModuleState m = SimBackend::module();
+    uint32_t dropped = SimBackend::stats().dropped - droppedBefore;
+    bool ok = started && m.status == 2 && m.volume == 0 && dropped == 0;
+    printf("sleep fade from %u: module status=%u volume=%u, %u dropped%s\n", level, m.status, m.volume, dropped,
+           ok ? "" : "  FAIL");
+    if (!ok) failures++;
+    audioTogglePause();
+    ms = runFor(ms, 1000);
+  }
+  return ms;
+}
+
+// Next while playing, on a module quick enough that the fades around the
+// play run at AUDIO_FADE_STEP_MIN_MS. Each skip must end at the user's
+// volume before reconciliation would look (RECONCILE_MIN_MS).
+static unsigned long checkSkipFades(unsigned long ms) {
+  SimBackend::setAckDelayMs(6);
+  setVolume(20);
+  if (getAudioStatus().state != PlaybackState::Playing) audioTogglePause();
+  ms = runFor(ms, 3000);
+  uint32_t droppedBefore = SimBackend::stats().dropped;
+  uint8_t wrong = 0;
+  for (uint8_t i = 0; i < 12; ++i) {
+    audioNext();
+    ms = runFor(ms, 1500);
+    SimModuleState m = SimBackend::module();
+    if (m.status != 1 || m.volume != getAudioStatus().volume) wrong++;
+  }
+  uint32_t dropped = SimBackend::stats().dropped - droppedBefore;
+  bool ok = wrong == 0 && dropped == 0;
+  printf("skips at %u ms ack: %u of 12 off volume, %u dropped%s\n", SimBackend::ackLatencyMs(), wrong, dropped,
+         ok ? "" : "  FAIL");
+  if (!ok) failures++;
+  SimBackend::setAckDelayMs(SimModuleConfig().ackDelayMs);
+  return ms;
+}
+
+// A burst that ends where it started (Next, Next, Prev) sends nothing after
+// its first play, and must not count anything either: the track it landed
+// on keeps playing, its clock keeps running, and leaving it later still
+// counts once.
+static unsigned long checkSkipBack(unsigned long ms) {
+  if (getAudioStatus().state != PlaybackState::Playing) audioTogglePause();
+  ms = runFor(ms, 3000);
+  audioNext(); // a lone tap, played at once
+  ms = runFor(ms, AUDIO_SKIP_COALESCE_MS / 2);
+  AudioStatus st = getAudioStatus();
+  TrackLocation loc{st.folder, st.file};
+  TrackStats before = statsGet(loc);
+  uint32_t elapsed = audioElapsedMs();
+  audioNext();
+  ms = runFor(ms, AUDIO_SKIP_COALESCE_MS / 2);
+  audioPrev();
+  ms = runFor(ms, 2000);
+  TrackStats during = statsGet(loc);
+  uint16_t index =
+      loc.folder == 0 ? SimBackend::indexOfMp3(loc.file) : SimBackend::indexOfFolderFile(loc.folder, loc.file);
+  bool ok = during.plays == before.plays && during.skips == before.skips && SimBackend::module().index == index &&
+            audioElapsedMs() - elapsed >= 2000 + AUDIO_SKIP_COALESCE_MS / 2;
+  audioNext();
+  ms = runFor(ms, 2000);
+  ok = ok && statsGet(loc).skips == before.skips + 1;
+  printf("next, next, prev: %s\n", ok ? "track kept, counted once" : "stats or clock off  FAIL");
+  if (!ok) failures++;
+  return ms;
+}
+
+static void act() {
+  switch (randomBelow(16)) {
+    case 0:
+    case 1:
+    case 2:
+      audioNext();
+      break;
+    case 3:
+      audioPrev();
+      break;
+    case 4:
+    case 5:
+      audioTogglePause();
+      break;
+    case 6:
+      audioVolumeUp();
+      break;
+    case 7:
+      audioVolumeDown();
+      break;
+    case 8:
+      audioJumpTo(1 + randomBelow(getAudioStatus().trackCount));
+      break;
+    case 9:
+      audioNextFolder();
+      break;
+    case 10:
+      audioSetShuffle(static_cast<ShuffleMode>(randomBelow(3)));
+      break;
+    case 11:
+      // A burst of skips, coalesced into one play.
+      for (uint8_t i = 0; i < 4; ++i) audioNext();
+      break;
+    case 12:
+      audioSetStandby(!audioStandby());
+      break;
+    default:
+      break; // just listen
+  }
+}
+
+static unsigned long runRandom(unsigned long from, uint32_t hours) {
+  unsigned long end = from + hours * 3600000UL;
+  unsigned long nextActionAt = from + 1000;
+  unsigned long recheckAt = 0;
+  unsigned long volumeFaultAt = 0;
+  uint8_t volumeFaultLevel = 0;
+  for (unsigned long ms = from; ms < end; ++ms) {
+    step(ms);
+    SimModuleState m = SimBackend::module();
+    AudioStatus st = getAudioStatus();
+
+    // An injected volume change is healed once reconciliation puts it back.
+    if (volumeFaultAt && (m.volume != volumeFaultLevel || audioStandby())) {
+      checks.volumeHealed++;
+      checks.worstHealMs = max<uint32_t>(checks.worstHealMs, ms - volumeFaultAt);
+      volumeFaultAt = 0;
+    }
+
+    bool settled = !audioStandby() && st.online && audioQuiet() && ms + 1000 < nextActionAt && !volumeFaultAt;
+    if (recheckAt && ms >= recheckAt) {
+      recheckAt = 0;
+      if (settled && !agrees(m, st)) {
+        checks.persistent++;
+        printf("%10.1f s  persistent: %s\n", ms / 1000.0, describe(m, st));
+      }
+    } else if (settled && ms % 997 == 0) {
+      checks.made++;
+      if (!agrees(m, st)) {
+        checks.differed++;
+        recheckAt = ms + 1000;
+      }
+    }
+
+    if (ms < nextActionAt) continue;
+    nextActionAt = ms + 2000 + randomBelow(240000);
+    uint32_t roll = randomBelow(40);
+    if (roll == 0 && m.status == 1 && !audioStandby()) {
+      volumeFaultLevel = static_cast<uint8_t>((m.volume + 7) % 31);
+      SimBackend::forceVolume(volumeFaultLevel);
+      volumeFaultAt = ms;
+      checks.volumeFaults++;
+    } else if (roll == 1) {
+      SimBackend::dropNextFinish();
+      checks.finishFaults++;
+    } else {
+      act();
+    }
+  }
+  return end;
+}
+
+// A player left alone in one state: UART frames and loop time per hour.
+static unsigned long runSettled(unsigned long from, uint32_t hours, const char *name) {
+  SimModuleStats before = SimBackend::moduleStats();
+  uint32_t loopsBefore = loops;
+  double nsBefore = loopNs;
+  unsigned long end = from + hours * 3600000UL;
+  for (unsigned long ms = from; ms < end; ++ms) step(ms);
+  const SimModuleStats &after = SimBackend::moduleStats();
+  printf("%-8s %u h: %.1f frames/h to the module, %.1f back, %.1f ns per audioLoop\n", name, hours,
+         static_cast<double>(after.framesIn - before.framesIn) / hours,
+         static_cast<double>(after.framesOut - before.framesOut) / hours, (loopNs - nsBefore) / (loops - loopsBefore));
+  return end;
+}
+
+int main() {
+  hostPartitionAdd("trkstats", 0x10000); // as in firmware/partitions.csv
+  SimModuleConfig cfg;
+  for (uint8_t f = 1; f <= 24; ++f) cfg.folderFiles[f] = 8 + (f * 5) % 11; // album folders, ~300 tracks
+  cfg.folderFiles[7] = 0;                                                 // a gap, as real cards tend to have
+  SimBackend::configure(cfg);
+  hostSetNowUs(0);
+  resumeBegin();
+  audioInit();
+  audioSetEndOfTrack(EndOfTrack::RepeatAll);
+
+  unsigned long ms = runFor(0, 5000);
+  ms = checkSleepFades(ms);
+  ms = checkSkipFades(ms);
+  ms = checkSkipBack(ms);
+  const uint32_t randomHours = 24;
+  ms = runRandom(ms, randomHours);
+  AudioStatus st = getAudioStatus();
+  SimModuleState m = SimBackend::module();
+  printf("after %u h: %s\n", randomHours, describe(m, st));
+  printf("checks=%u differed=%u persistent=%u volume faults=%u healed=%u (worst %.1f s) dropped 0x3D=%u\n",
+         checks.made, checks.differed, checks.persistent, checks.volumeFaults, checks.volumeHealed,
+         checks.worstHealMs / 1000.0, checks.finishFaults);
+  const SimModuleStats &mod = SimBackend::moduleStats();
+  printf("module: framesIn=%u framesOut=%u errors=%u started=%u finished=%u\n", mod.framesIn, mod.framesOut,
+         mod.errorsOut, mod.tracksStarted, mod.tracksFinished);
+  printLink("after the random run");
+  audioPrintStats(Serial);
+
+  // Into a paused state, from whatever the listener left behind.
+  if (audioStandby()) audioSetStandby(false);
+  for (uint8_t i = 0; i < 3 && getAudioStatus().state != PlaybackState::Paused; ++i) {
+    for (unsigned long until = ms + 5000; ms < until; ++ms) step(ms);
+    if (getAudioStatus().state != PlaybackState::Paused) audioTogglePause();
+  }
+  for (unsigned long until = ms + 5000; ms < until; ++ms) step(ms);
+  printf("\nsettled player:\n");
+  ms = runSettled(ms, 2, "paused");
+  audioTogglePause();
+  ms = runSettled(ms, 2, "playing");
+  audioSetStandby(true);
+  ms = runSettled(ms, 2, "bt");
+  printf("\n%u audioLoop calls, %.1f ns each on average\n", loops, loopNs / loops);
+  printLink("at the end");
+  if (SimBackend::stats().dropped > 0) {
+    printf("FAIL: %u commands dropped by a full queue\n", SimBackend::stats().dropped);
+    failures++;
+  }
+  return failures == 0 && checks.persistent == 0 && checks.volumeHealed == checks.volumeFaults ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+// Checks that firmware/shuffle.cpp yields a permutation every epoch and times
+// next-track selection at library sizes up to the 16-bit limit.
+// Build: see README.md.
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <vector>
+
+#include "../../firmware/shuffle.h"
+
+static bool checkEpochs(uint16_t count, uint16_t first, uint32_t seed, int epochs) {
+  shuffleBegin(count, first, seed);
+  if (shuffleCurrent() != first) return false;
+  std::vector<uint8_t> seen(count + 1);
+  uint16_t track = shuffleCurrent();
+  for (int e = 0; e < epochs; ++e) {
+    std::fill(seen.begin(), seen.end(), 0);
+    for (uint32_t i = 0; i < count; ++i) {
+      if (track < 1 || track > count || seen[track]) return false;
+      seen[track] = 1;
+      track = shuffleNext();
+    }
+  }
+  return true;
+}
+
+static bool checkPrev(uint16_t count) {
+  shuffleBegin(count, 1, 1234);
+  uint16_t trail[40];
+  for (int i = 0; i < 40; ++i) {
+    trail[i] = shuffleCurrent();
+    shuffleNext();
+  }
+  // The ring remembers the last SHUFFLE_HISTORY_LEN tracks, newest first.
+  for (int i = 39; i >= 40 - SHUFFLE_HISTORY_LEN; --i) {
+    if (shufflePrev() != trail[i]) return false;
+  }
+  return true;
+}
+
+static void bench(uint16_t count) {
+  const uint32_t calls = 2000000;
+  shuffleBegin(count, 1, 0xC0FFEEu);
+  uint32_t sum = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < calls; ++i) sum += shuffleNext();
+  auto t1 = std::chrono::steady_clock::now();
+  double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / calls;
+  printf("n=%5u  next %.1f ns  state %u bytes (a shuffled table would need %u)  check %u\n", count, ns,
+         static_cast<unsigned>(sizeof(ShuffleState)), count * 2u, sum);
+}
+
+int main() {
+  const uint16_t sizes[] = {1, 2, 3, 17, 255, 3000, 4097, 9999, 65535};
+  bool ok = true;
+  for (uint16_t n : sizes) {
+    for (uint32_t seed : {1u, 42u, 0xDEADBEEFu}) {
+      if (!checkEpochs(n, static_cast<uint16_t>(n / 2 + 1), seed, 3)) {
+        printf("FAIL permutation n=%u seed=%u\n", n, seed);
+        ok = false;
+      }
+    }
+  }
+  if (!checkPrev(3000)) {
+    printf("FAIL prev history\n");
+    ok = false;
+  }
+  printf("permutation/prev checks: %s\n", ok ? "ok" : "FAILED");
+  for (uint16_t n : {3000, 9999, 65535}) bench(n);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,408 @@
+#include "sim_backend.h"
+
+#include <algorithm>
+#include <vector>
+
+static const uint8_t EVENT_QUEUE_LEN = 8; // as in dfplayer.cpp
+
+struct PendingCommand {
+  uint8_t command;
+  bool timed;
+  uint16_t param;
+  uint16_t afterMs;
+};
+
+// A frame on its way across the link: to the module (`in`) or back.
+struct WireFrame {
+  unsigned long at;
+  bool in;
+  uint8_t command;
+  uint16_t param;
+};
+
+// Host side, the same bookkeeping as dfplayer.cpp.
+static PendingCommand txQueue[DFPLAYER_QUEUE_LEN];
+static uint8_t txHead = 0;
+static uint8_t txCount = 0;
+static uint8_t timedCount = 0;
+static DfEvent eventQueue[EVENT_QUEUE_LEN];
+static uint8_t eventHead = 0;
+static uint8_t eventCount = 0;
+static bool inFlight = false;
+static uint8_t inFlightCommand = 0;
+static uint16_t inFlightParam = 0;
+static unsigned long inFlightSentAt = 0;
+static unsigned long lastTxAt = 0;
+static uint16_t ackLatencyX8 = 0;
+static DfStats linkStats{};
+
+// Module side.
+static SimModuleConfig cfg;
+static std::vector<WireFrame> wire; // kept sorted by `at`
+static unsigned long moduleTxFreeAt = 0;
+static unsigned long bootedAt = 0; // the module listens from here on
+static uint8_t status = 0;
+static uint16_t currentIndex = 0;
+static unsigned long trackEndsAt = 0; // valid while playing
+static unsigned long remainingMs = 0; // valid while paused
+static uint8_t volume = 20;
+static uint8_t eq = 0;
+static bool dropFinish = false;
+static SimModuleStats moduleCounters{};
+
+static void pushEvent(DfEventType type, uint8_t command, uint16_t param, unsigned long now) {
+  if (eventCount == EVENT_QUEUE_LEN) {
+    eventHead = (eventHead + 1) % EVENT_QUEUE_LEN;
+    eventCount--;
+  }
+  DfEvent &ev = eventQueue[(eventHead + eventCount) % EVENT_QUEUE_LEN];
+  ev.type = type;
+  ev.command = command;
+  ev.param = param;
+  ev.at = now;
+  eventCount++;
+}
+
+static void schedule(const WireFrame &frame) {
+  auto pos = std::upper_bound(wire.begin(), wire.end(), frame,
+                              [](const WireFrame &a, const WireFrame &b) { return a.at < b.at; });
+  wire.insert(pos, frame);
+}
+
+// The module writes frames one after the other on its TX line.
+static void moduleEmit(uint8_t command, uint16_t param, unsigned long at) {
+  unsigned long start = max(at, moduleTxFreeAt);
+  moduleTxFreeAt = start + cfg.frameMs;
+  moduleCounters.framesOut++;
+  schedule({moduleTxFreeAt, false, command, param});
+}
+
+static uint16_t totalFiles() {
+  uint32_t total = cfg.mp3Files;
+  for (uint8_t f = 1; f < 100; ++f) total += cfg.folderFiles[f];
+  return static_cast<uint16_t>(min<uint32_t>(total, 0xFFFF));
+}
+
+static bool startTrack(uint16_t index, unsigned long now) {
+  if (index == 0) return false;
+  currentIndex = index;
+  status = 1;
+  trackEndsAt = now + SimBackend::trackDurationMs(index);
+  moduleCounters.tracksStarted++;
+  return true;
+}
+
+static void moduleError(uint8_t code, unsigned long now) {
+  moduleCounters.errorsOut++;
+  moduleEmit(DfMsg::Error, code, now + cfg.ackDelayMs);
+}
+
+static void moduleReceive(uint8_t command, uint16_t param, unsigned long now) {
+  moduleCounters.framesIn++;
+  if (static_cast<long>(now - bootedAt) < 0) return; // the real module ignores the UART until it has booted
+  bool ok = true;
+  uint16_t total = totalFiles();
+  unsigned long replyAt = now + cfg.replyDelayMs;
+  switch (command) {
+    case DfCmd::Next:
+      ok = startTrack(currentIndex >= total ? 1 : currentIndex + 1, now);
+      break;
+    case DfCmd::Prev:
+      ok = startTrack(currentIndex <= 1 ? total : currentIndex - 1, now);
+      break;
+    case DfCmd::PlayTrack:
+      ok = param >= 1 && param <= total && startTrack(param, now);
+      break;
+    case DfCmd::PlayFolder:
+      ok = startTrack(SimBackend::indexOfFolderFile(param >> 8, param & 0xFF), now);
+      break;
+    case DfCmd::PlayMp3Folder:
+      ok = startTrack(SimBackend::indexOfMp3(param), now);
+      break;
+    case DfCmd::SetVolume:
+      volume = static_cast<uint8_t>(min<uint16_t>(param, 30));
+      break;
+    case DfCmd::SetEq:
+      eq = static_cast<uint8_t>(min<uint16_t>(param, 5));
+      break;
+    case DfCmd::Pause:
+      if (status == 1) {
+        remainingMs = trackEndsAt > now ? trackEndsAt - now : 0;
+        status = 2;
+      }
+      break;
+    case DfCmd::Resume:
+      if (status == 2) {
+        trackEndsAt = now + remainingMs;
+        status = 1;
+      } else if (status == 0 && currentIndex) {
+        startTrack(currentIndex, now);
+      }
+      break;
+    case DfCmd::Stop:
+      status = 0;
+      break;
+    case DfCmd::Reset:
+      SimBackend::powerCycle();
+      return;
+    case DfCmd::QueryStatus:
+      moduleEmit(command, 0x0200 | status, replyAt);
+      return;
+    case DfCmd::QueryVolume:
+      moduleEmit(command, volume, replyAt);
+      return;
+    case DfCmd::QueryEq:
+      moduleEmit(command, eq, replyAt);
+      return;
+    case DfCmd::QueryTfFiles:
+      moduleEmit(command, total, replyAt);
+      return;
+    case DfCmd::QueryTfTrack:
+      moduleEmit(command, currentIndex, replyAt);
+      return;
+    case DfCmd::QueryFolderFiles: {
+      uint8_t folder = static_cast<uint8_t>(param);
+      if (folder < 1 || folder > 99 || cfg.folderFiles[folder] == 0) {
+        moduleError(DfError::NotFound, now);
+      } else {
+        moduleEmit(command, cfg.folderFiles[folder], replyAt);
+      }
+      return;
+    }
+    case DfCmd::QueryFolders: {
+      uint16_t folders = 0;
+      for (uint8_t f = 1; f < 100; ++f) folders += cfg.folderFiles[f] ? 1 : 0;
+      moduleEmit(command, folders, replyAt);
+      return;
+    }
+    default:
+      moduleError(DfError::SerialError, now);
+      return;
+  }
+  if (ok) {
+    moduleEmit(DfMsg::Ack, 0, now + cfg.ackDelayMs);
+  } else {
+    moduleError(DfError::NotFound, now);
+  }
+}
+
+static void trackEnded() {
+  status = 0;
+  moduleCounters.tracksFinished++;
+  if (dropFinish) {
+    dropFinish = false;
+    return;
+  }
+  moduleEmit(DfMsg::TfFinished, currentIndex, trackEndsAt);
+  moduleEmit(DfMsg::TfFinished, currentIndex, trackEndsAt + cfg.finishRepeatMs);
+}
+
+// A module frame has arrived; what dfplayer.cpp's handleFrame() does with it.
+static void hostReceive(uint8_t command, uint16_t param, unsigned long now) {
+  linkStats.rxFrames++;
+  switch (command) {
+    case DfMsg::Ack:
+      linkStats.acks++;
+      if (inFlight && !dfIsQuery(inFlightCommand)) {
+        uint16_t sample = min<unsigned long>(now - inFlightSentAt, DFPLAYER_ACK_TIMEOUT_MS);
+        ackLatencyX8 = ackLatencyX8 == 0 ? sample * 8 : ackLatencyX8 - ackLatencyX8 / 8 + sample;
+        inFlight = false;
+        pushEvent(DfEventType::Ack, inFlightCommand, inFlightParam, now);
+      }
+      break;
+    case DfMsg::Error:
+      pushEvent(DfEventType::Error, inFlight ? inFlightCommand : 0, param, now);
+      inFlight = false;
+      break;
+    case DfMsg::TfFinished:
+      pushEvent(DfEventType::TrackFinished, command, param, now);
+      break;
+    case DfMsg::InitDone:
+      pushEvent(DfEventType::InitDone, command, param, now);
+      break;
+    default:
+      if (dfIsQuery(command)) {
+        if (inFlight && inFlightCommand == command) inFlight = false;
+        pushEvent(DfEventType::Reply, command, param, now);
+      }
+      break;
+  }
+}
+
+// Runs the module and the wire up to `now`, in time order.
+static void advance(unsigned long now) {
+  for (;;) {
+    bool frameDue = !wire.empty() && static_cast<long>(now - wire.front().at) >= 0;
+    bool endDue = status == 1 && static_cast<long>(now - trackEndsAt) >= 0;
+    if (endDue && (!frameDue || static_cast<long>(wire.front().at - trackEndsAt) > 0)) {
+      trackEnded();
+      continue;
+    }
+    if (!frameDue) break;
+    WireFrame f = wire.front();
+    wire.erase(wire.begin());
+    if (f.in) {
+      moduleReceive(f.command, f.param, f.at);
+    } else {
+      hostReceive(f.command, f.param, now);
+    }
+  }
+}
+
+void SimBackend::begin() {
+  txHead = txCount = 0;
+  timedCount = 0;
+  eventHead = eventCount = 0;
+  inFlight = false;
+}
+
+static bool enqueue(uint8_t command, uint16_t param, uint16_t afterMs, bool timed) {
+  if (txCount == DFPLAYER_QUEUE_LEN) {
+    linkStats.dropped++;
+    return false;
+  }
+  PendingCommand &slot = txQueue[(txHead + txCount) % DFPLAYER_QUEUE_LEN];
+  slot.command = command;
+  slot.timed = timed;
+  slot.param = param;
+  slot.afterMs = afterMs;
+  txCount++;
+  if (timed) timedCount++;
+  linkStats.queued++;
+  return true;
+}
+
+bool SimBackend::send(uint8_t command, uint16_t param) {
+  return enqueue(command, param, 0, false);
+}
+
+bool SimBackend::sendAfter(uint8_t command, uint16_t param, uint16_t afterMs) {
+  return enqueue(command, param, afterMs, true);
+}
+
+uint8_t SimBackend::cancelTimed() {
+  if (timedCount == 0) return 0;
+  uint8_t kept = 0;
+  for (uint8_t i = 0; i < txCount; ++i) {
+    const PendingCommand &c = txQueue[(txHead + i) % DFPLAYER_QUEUE_LEN];
+    if (!c.timed) txQueue[(txHead + kept++) % DFPLAYER_QUEUE_LEN] = c;
+  }
+  uint8_t removed = txCount - kept;
+  txCount = kept;
+  timedCount = 0;
+  linkStats.cancelled += removed;
+  return removed;
+}
+
+bool SimBackend::timedPending() {
+  return timedCount > 0;
+}
+
+uint8_t SimBackend::queueFree() {
+  return DFPLAYER_QUEUE_LEN - txCount;
+}
+
+uint16_t SimBackend::ackLatencyMs() {
+  return ackLatencyX8 / 8;
+}
+
+void SimBackend::service(unsigned long now) {
+  advance(now);
+
+  if (inFlight && now - inFlightSentAt > DFPLAYER_ACK_TIMEOUT_MS) {
+    inFlight = false;
+    linkStats.timeouts++;
+    pushEvent(DfEventType::Timeout, inFlightCommand, 0, now);
+  }
+
+  if (inFlight || txCount == 0) return;
+  const PendingCommand &head = txQueue[txHead];
+  if (now - lastTxAt < max<uint16_t>(DFPLAYER_CMD_GAP_MS, head.afterMs)) return;
+
+  PendingCommand next = head;
+  txHead = (txHead + 1) % DFPLAYER_QUEUE_LEN;
+  txCount--;
+  if (next.timed) timedCount--;
+  schedule({now + cfg.frameMs, true, next.command, next.param});
+  inFlight = true;
+  inFlightCommand = next.command;
+  inFlightParam = next.param;
+  inFlightSentAt = now;
+  lastTxAt = now;
+  linkStats.sent++;
+}
+
+bool SimBackend::pollEvent(DfEvent &ev) {
+  if (eventCount == 0) return false;
+  ev = eventQueue[eventHead];
+  eventHead = (eventHead + 1) % EVENT_QUEUE_LEN;
+  eventCount--;
+  return true;
+}
+
+bool SimBackend::idle() {
+  return !inFlight && txCount == 0;
+}
+
+void SimBackend::flush() {
+  txHead = txCount = 0;
+  timedCount = 0;
+}
+
+const DfStats &SimBackend::stats() {
+  return linkStats;
+}
+
+void SimBackend::configure(const SimModuleConfig &config) {
+  cfg = config;
+  powerCycle();
+}
+
+void SimBackend::powerCycle() {
+  unsigned long now = millis();
+  wire.erase(std::remove_if(wire.begin(), wire.end(), [](const WireFrame &f) { return !f.in; }), wire.end());
+  moduleTxFreeAt = now;
+  bootedAt = now + cfg.bootMs;
+  status = 0;
+  currentIndex = 0;
+  volume = 20;
+  eq = 0;
+  moduleEmit(DfMsg::InitDone, 0x02, bootedAt);
+}
+
+void SimBackend::setAckDelayMs(uint16_t ms) {
+  cfg.ackDelayMs = ms;
+}
+
+SimModuleState SimBackend::module() {
+  return {status, currentIndex, volume, eq, static_cast<long>(millis() - bootedAt) >= 0};
+}
+
+const SimModuleStats &SimBackend::moduleStats() {
+  return moduleCounters;
+}
+
+uint16_t SimBackend::indexOfFolderFile(uint8_t folder, uint16_t file) {
+  if (folder < 1 || folder > 99 || file < 1 || file > cfg.folderFiles[folder]) return 0;
+  uint32_t index = 0;
+  for (uint8_t f = 1; f < folder; ++f) index += cfg.folderFiles[f];
+  return static_cast<uint16_t>(index + file);
+}
+
+uint16_t SimBackend::indexOfMp3(uint16_t file) {
+  if (file < 1 || file > cfg.mp3Files) return 0;
+  return static_cast<uint16_t>(totalFiles() - cfg.mp3Files + file);
+}
+
+uint32_t SimBackend::trackDurationMs(uint16_t index) {
+  if (cfg.trackMsSpread == 0) return cfg.trackMs;
+  return cfg.trackMs + (static_cast<uint32_t>(index) * 7919u) % cfg.trackMsSpread;
+}
+
+void SimBackend::forceVolume(uint8_t level) {
+  volume = level;
+}
+
+void SimBackend::dropNextFinish() {
+  dropFinish = true;
+}
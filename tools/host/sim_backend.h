@@ -0,0 +1,77 @@
+#pragma once
+
+// AudioBackend for host builds of the playback engine (-DAUDIO_BACKEND_SIM,
+// see firmware/audio_backend.h). It stands in for dfplayer.cpp and the module
+// together: commands go through the same queue rules (one frame in flight,
+// DFPLAYER_CMD_GAP_MS spacing, timed entries, DFPLAYER_ACK_TIMEOUT_MS), and a
+// module model on millis() answers them after the frame, ack and reply times
+// of the real link. No bytes are encoded or parsed, so hours of playback run
+// in a fraction of a second; audio_sim covers the wire itself.
+//
+// The module side follows dfplayer_emu: SD layout, track durations, the
+// doubled 0x3D, NotFound for missing files and folders, and a boot delay
+// before it listens.
+
+#include <Arduino.h>
+
+#include "../../firmware/dfplayer.h"
+
+struct SimModuleConfig {
+  uint16_t folderFiles[100] = {0}; // [1..99] -> files in /NN/NNN.mp3
+  uint16_t mp3Files = 0;           // /mp3/NNNN.mp3
+  uint32_t trackMs = 180000;       // base duration; each file gets a stable offset
+  uint32_t trackMsSpread = 60000;  // 0 -> every file lasts exactly trackMs
+  uint16_t bootMs = 800;           // power-on -> 0x3F
+  uint16_t frameMs = 11;           // 10 bytes at 9600 baud
+  uint16_t ackDelayMs = 12;        // frame received -> ack starts
+  uint16_t replyDelayMs = 25;      // frame received -> query reply starts
+  uint16_t finishRepeatMs = 30;    // module repeats 0x3D once after this
+};
+
+// What the module is doing, for checks against the engine's model.
+struct SimModuleState {
+  uint8_t status; // as 0x42 reports it: 0 stopped, 1 playing, 2 paused
+  uint16_t index; // file playing or last played, in FAT order
+  uint8_t volume;
+  uint8_t eq;
+  bool booted;
+};
+
+struct SimModuleStats {
+  uint32_t framesIn;  // host -> module
+  uint32_t framesOut; // module -> host, acks and 0x3D included
+  uint32_t errorsOut;
+  uint32_t tracksStarted;
+  uint32_t tracksFinished;
+};
+
+struct SimBackend {
+  // The AudioBackend contract (audio_backend.h).
+  static void begin();
+  static bool send(uint8_t command, uint16_t param = 0);
+  static bool sendAfter(uint8_t command, uint16_t param, uint16_t afterMs);
+  static uint8_t cancelTimed();
+  static bool timedPending();
+  static uint8_t queueFree();
+  static uint16_t ackLatencyMs();
+  static void service(unsigned long now);
+  static bool pollEvent(DfEvent &ev);
+  static bool idle();
+  static void flush();
+  static const DfStats &stats();
+
+  // Module side. configure() also power-cycles it.
+  static void configure(const SimModuleConfig &config);
+  static void powerCycle();
+  // A quicker or slower module, from the next frame on.
+  static void setAckDelayMs(uint16_t ms);
+  static SimModuleState module();
+  static const SimModuleStats &moduleStats();
+  // FAT index of /NN/NNN.mp3 (0 if missing), to compare with module().index.
+  static uint16_t indexOfFolderFile(uint8_t folder, uint16_t file);
+  static uint16_t indexOfMp3(uint16_t file);
+  static uint32_t trackDurationMs(uint16_t index);
+  // Faults the engine is not told about, as in dfplayer_emu.
+  static void forceVolume(uint8_t level);
+  static void dropNextFinish();
+};
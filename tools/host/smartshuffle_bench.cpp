@@ -0,0 +1,146 @@
+// Checks firmware/smartshuffle.cpp: draws follow the weights (chi-square
+// goodness of fit), the recent window never repeats, Prev retraces it, and
+// a listener who skips half the library hears that half less. Then times a
+// draw and a rebuild at library sizes up to SMART_SHUFFLE_MAX_TRACKS.
+// Build: see README.md.
+
+#include <Arduino.h>
+
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+#include "../../firmware/smartshuffle.h"
+
+static std::vector<TrackStats> history(SMART_SHUFFLE_MAX_TRACKS + 1);
+
+static uint8_t weightOf(uint16_t track) {
+  return smartShuffleWeight(history[track]);
+}
+
+// A spread of histories: unheard, loved, skipped, favourites.
+static void seedHistory(uint16_t count) {
+  for (uint16_t t = 1; t <= count; ++t) {
+    history[t] = TrackStats{static_cast<uint16_t>(t % 7 * 3), static_cast<uint16_t>(t % 5 * 4), t % 11 == 0};
+  }
+}
+
+static bool checkDistribution(uint16_t count, uint32_t draws) {
+  seedHistory(count);
+  smartShuffleBegin(count, 1, 0xA5A5u, weightOf, 0);
+  std::vector<uint32_t> seen(count + 1);
+  for (uint32_t i = 0; i < draws; ++i) seen[smartShuffleNext()]++;
+
+  double total = 0;
+  for (uint16_t t = 1; t <= count; ++t) total += weightOf(t);
+  double chi2 = 0;
+  for (uint16_t t = 1; t <= count; ++t) {
+    double expected = draws * weightOf(t) / total;
+    chi2 += (seen[t] - expected) * (seen[t] - expected) / expected;
+  }
+  // chi-square with count-1 degrees of freedom: mean df, sd sqrt(2 df).
+  double df = count - 1;
+  double z = (chi2 - df) / std::sqrt(2 * df);
+  bool ok = std::fabs(z) < 4;
+  printf("n=%4u  %u draws  chi2=%.1f df=%.0f z=%+.2f  %s\n", count, draws, chi2, df, z, ok ? "ok" : "FAILED");
+  return ok;
+}
+
+static bool checkWindow(uint16_t count, uint8_t window) {
+  seedHistory(count);
+  smartShuffleBegin(count, 1, 77, weightOf, window);
+  uint8_t held = min<uint16_t>(min<uint16_t>(window, SMART_SHUFFLE_RECENT), count / 2);
+  std::vector<int64_t> last(count + 1, -1000000);
+  std::vector<uint8_t> heard(count + 1);
+  last[1] = 0;
+  for (int64_t i = 1; i <= 200000; ++i) {
+    uint16_t t = smartShuffleNext();
+    if (t < 1 || t > count || i - last[t] <= held) {
+      printf("FAIL window n=%u: track %u again after %lld draws\n", count, t, static_cast<long long>(i - last[t]));
+      return false;
+    }
+    last[t] = i;
+    heard[t] = 1;
+  }
+  for (uint16_t t = 1; t <= count; ++t) {
+    if (!heard[t]) {
+      printf("FAIL window n=%u: track %u never drawn\n", count, t);
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool checkPrev() {
+  seedHistory(500);
+  smartShuffleBegin(500, 9, 5, weightOf);
+  uint16_t trail[SMART_SHUFFLE_RECENT];
+  trail[0] = smartShuffleCurrent();
+  for (uint8_t i = 1; i < SMART_SHUFFLE_RECENT; ++i) trail[i] = smartShuffleNext();
+  for (int i = SMART_SHUFFLE_RECENT - 2; i >= 0; --i) {
+    if (smartShufflePrev() != trail[i]) return false;
+  }
+  if (smartShufflePrev() != trail[0]) return false; // the ring ends here
+  for (uint8_t i = 1; i < SMART_SHUFFLE_RECENT; ++i) {
+    if (smartShuffleNext() != trail[i]) return false;
+  }
+  return true;
+}
+
+// Odd tracks get skipped every time, even ones played through. Weights are
+// re-read as tracks leave the window, so the mix shifts while it plays.
+static bool checkLearning(uint16_t count) {
+  for (uint16_t t = 1; t <= count; ++t) history[t] = TrackStats{0, 0, false};
+  smartShuffleBegin(count, 1, 99, weightOf);
+  uint32_t evenLate = 0;
+  const uint32_t draws = 50000, late = 10000;
+  for (uint32_t i = 0; i < draws; ++i) {
+    uint16_t t = smartShuffleNext();
+    if (t % 2) {
+      history[t].skips++;
+    } else {
+      history[t].plays++;
+    }
+    if (i >= draws - late && t % 2 == 0) evenLate++;
+  }
+  double share = static_cast<double>(evenLate) / late;
+  printf("learning n=%u: played-through half gets %.1f%% of the last %u draws\n", count, share * 100, late);
+  return share > 0.8;
+}
+
+template <typename F>
+static double timeNs(F fn, uint32_t runs) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < runs; ++i) fn();
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() / runs;
+}
+
+static void bench(uint16_t count) {
+  seedHistory(count);
+  smartShuffleBegin(count, 1, 0xC0FFEEu, weightOf);
+  uint32_t sum = 0;
+  double next = timeNs([&] { sum += smartShuffleNext(); }, 2000000);
+  double build = timeNs([&] { smartShuffleBegin(count, 1, sum, weightOf); }, 200);
+  printf("n=%4u  next %.1f ns  rebuild %.1f us  state %u bytes  check %u\n", count, next, build / 1000,
+         static_cast<unsigned>(count * (sizeof(uint32_t) + 1) + SMART_SHUFFLE_RECENT * 2), sum);
+}
+
+int main() {
+  bool ok = true;
+  ok = checkDistribution(1000, 2000000) && ok;
+  ok = checkDistribution(SMART_SHUFFLE_MAX_TRACKS, 8000000) && ok;
+  for (int n : {2, 3, 17, 64, 1000, int(SMART_SHUFFLE_MAX_TRACKS)}) {
+    ok = checkWindow(n, SMART_SHUFFLE_RECENT) && ok;
+  }
+  ok = checkWindow(300, 5) && ok;
+  if (!checkPrev()) {
+    printf("FAIL prev history\n");
+    ok = false;
+  }
+  ok = checkLearning(1000) && ok;
+  ok = !smartShuffleBegin(SMART_SHUFFLE_MAX_TRACKS + 1, 1, 1, weightOf) && ok;
+  printf("distribution/window/prev/learning checks: %s\n", ok ? "ok" : "FAILED");
+  for (int n : {1000, 3000, int(SMART_SHUFFLE_MAX_TRACKS)}) bench(n);
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,162 @@
+// Drives firmware/trackstats.cpp with random plays, skips and favourite
+// toggles over a 64 KB partition, rebooting now and then and cutting the
+// power in the middle of a write, and checks every reboot against a shadow
+// copy. Reports sector wear and query times.
+// Build: see README.md.
+
+#include <Arduino.h>
+#include <esp_partition.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include "../../firmware/trackstats.h"
+
+static const uint8_t FOLDERS = 20;
+static const uint16_t FILES = 100; // 2000 tracks
+static const uint32_t UPDATES = 300000;
+static const uint32_t REBOOT_EVERY = 5000;
+static const uint32_t CUT_EVERY = 7919; // prime, so cuts land on every kind of write
+
+struct Shadow {
+  uint16_t plays = 0;
+  uint16_t skips = 0;
+  bool favorite = false;
+};
+
+static std::vector<Shadow> shadow(FOLDERS * FILES);
+static uint32_t rng = 0x1234567;
+
+static uint32_t nextRandom() {
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static TrackLocation locOf(uint32_t i) {
+  return TrackLocation{static_cast<uint8_t>(i / FILES + 1), static_cast<uint16_t>(i % FILES + 1)};
+}
+
+static bool matchesShadow() {
+  for (uint32_t i = 0; i < shadow.size(); ++i) {
+    TrackStats s = statsGet(locOf(i));
+    if (s.plays != shadow[i].plays || s.skips != shadow[i].skips || s.favorite != shadow[i].favorite) {
+      printf("FAIL track %02u/%03u: %u/%u/%d, expected %u/%u/%d\n", locOf(i).folder, locOf(i).file, s.plays,
+             s.skips, s.favorite, shadow[i].plays, shadow[i].skips, shadow[i].favorite);
+      return false;
+    }
+  }
+  return true;
+}
+
+// A play count skewed towards a few favourites, as real listening is.
+static uint32_t pickTrack() {
+  uint32_t r = nextRandom();
+  return (r & 3) ? (r >> 8) % 50 : (r >> 8) % shadow.size();
+}
+
+static bool checkQueries() {
+  TrackLocation out[PLAYLIST_CAPACITY];
+  uint16_t n = statsMostPlayed(out, PLAYLIST_CAPACITY);
+  std::vector<uint32_t> order(shadow.size());
+  for (uint32_t i = 0; i < order.size(); ++i) order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [](uint32_t a, uint32_t b) {
+    return shadow[a].plays != shadow[b].plays ? shadow[a].plays > shadow[b].plays : shadow[a].skips < shadow[b].skips;
+  });
+  for (uint16_t i = 0; i < n; ++i) {
+    TrackStats got = statsGet(out[i]);
+    const Shadow &want = shadow[order[i]];
+    if (got.plays != want.plays || got.skips != want.skips) {
+      printf("FAIL most played #%u\n", i);
+      return false;
+    }
+  }
+  n = statsFavorites(out, PLAYLIST_CAPACITY);
+  uint16_t f = 0;
+  for (uint32_t i = 0; i < shadow.size() && f < PLAYLIST_CAPACITY; ++i) {
+    if (!shadow[i].favorite) continue;
+    if (f >= n || out[f].folder != locOf(i).folder || out[f].file != locOf(i).file) {
+      printf("FAIL favourite #%u\n", f);
+      return false;
+    }
+    ++f;
+  }
+  return f == n;
+}
+
+template <typename F>
+static double timeUs(F fn, int runs) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (int i = 0; i < runs; ++i) fn();
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::micro>(t1 - t0).count() / runs;
+}
+
+int main() {
+  hostPartitionAdd("trkstats", 0x10000);
+  if (!statsBegin()) {
+    printf("FAIL no partition\n");
+    return 1;
+  }
+  bool ok = true;
+  uint32_t reboots = 0;
+  uint32_t cuts = 0;
+  for (uint32_t u = 1; u <= UPDATES && ok; ++u) {
+    uint32_t i = pickTrack();
+    TrackLocation loc = locOf(i);
+    bool cut = u % CUT_EVERY == 0;
+    if (cut) hostPartitionCutPower(nextRandom() % 16);
+    uint32_t kind = nextRandom() % 16;
+    Shadow next = shadow[i];
+    if (kind == 0) {
+      next.favorite = statsToggleFavorite(loc);
+    } else if (kind < 6) {
+      statsNoteSkip(loc);
+      next.skips++;
+    } else {
+      statsNotePlay(loc);
+      next.plays++;
+    }
+    if (!cut) {
+      shadow[i] = next;
+      statsLoop();
+    }
+    if (cut || u % REBOOT_EVERY == 0) {
+      hostPartitionPowerOn();
+      statsBegin();
+      // The update in flight when the power went may be lost, or may have
+      // landed if the cut only missed bytes that stay 0xFF; nothing else changes.
+      TrackStats got = statsGet(loc);
+      if (cut && got.plays == next.plays && got.skips == next.skips && got.favorite == next.favorite) {
+        shadow[i] = next;
+      }
+      reboots++;
+      cuts += cut ? 1 : 0;
+      ok = matchesShadow();
+    }
+  }
+  ok = ok && checkQueries();
+  printf("%u updates over %u tracks, %u reboots (%u power cuts): %s\n", UPDATES,
+         static_cast<unsigned>(shadow.size()), reboots, cuts, ok ? "ok" : "FAILED");
+  statsPrintStats(Serial);
+
+  uint16_t sectors;
+  const uint32_t *erases = hostPartitionErases("trkstats", &sectors);
+  uint32_t lo = erases[0], hi = erases[0], total = 0;
+  for (uint16_t s = 0; s < sectors; ++s) {
+    lo = std::min(lo, erases[s]);
+    hi = std::max(hi, erases[s]);
+    total += erases[s];
+  }
+  printf("wear: %u erases over %u sectors, min %u max %u per sector (%.1f updates per erase)\n", total, sectors, lo,
+         hi, static_cast<double>(UPDATES) / total);
+
+  TrackLocation out[PLAYLIST_CAPACITY];
+  printf("host times: boot load %.1f us, favourites %.2f us, most played %.2f us, lookup %.3f us\n",
+         timeUs([] { statsBegin(); }, 50), timeUs([&] { statsFavorites(out, PLAYLIST_CAPACITY); }, 2000),
+         timeUs([&] { statsMostPlayed(out, PLAYLIST_CAPACITY); }, 2000),
+         timeUs([] { statsGet(locOf(nextRandom() % (FOLDERS * FILES))); }, 200000));
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,297 @@
+#!/usr/bin/env python3
+"""Generate firmware/track_index_data.h from the contents of a DFPlayer SD card.
+
+The DFPlayer only knows file numbers, so titles, artists and durations are
+read here on the host and baked into flash. Point the script at the card's
+root (a mounted card, or a directory extracted from an image with e.g.
+`mcopy -s -i card.img ::/ card/`) and rebuild the firmware whenever the card
+content changes:
+
+    python3 tools/make_track_index.py /media/SDCARD
+
+Layout handled: /mp3/NNNN*.mp3 (what the firmware plays today) and
+/NN/NNN*.mp3 folders 01..99. Records are stored folder by folder ordered by
+file number, with empty records filling numbering gaps, so a lookup is
+`records[folderFirst[folder] + file - 1]`.
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+import unicodedata
+
+MAX_TEXT = 40  # characters kept per title/artist; the panel shows fewer
+RECORD_BYTES = 8  # uint32 title offset, uint16 artist index, uint16 seconds
+
+BITRATES = {
+    (1, 1): [0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448],
+    (1, 2): [0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384],
+    (1, 3): [0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320],
+    (2, 1): [0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256],
+    (2, 2): [0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160],
+    (2, 3): [0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160],
+}
+SAMPLE_RATES = {1: [44100, 48000, 32000], 2: [22050, 24000, 16000], 25: [11025, 12000, 8000]}
+
+
+def to_ascii(text):
+    """The panel font is 7-bit ASCII; fold accents and drop the rest."""
+    text = unicodedata.normalize("NFKD", text)
+    text = "".join(c for c in text if 32 <= ord(c) < 127)
+    return " ".join(text.split())[:MAX_TEXT]
+
+
+def decode_text(data):
+    if not data:
+        return ""
+    enc, body = data[0], data[1:]
+    try:
+        if enc == 0:
+            s = body.decode("latin-1")
+        elif enc == 1:
+            s = body.decode("utf-16")
+        elif enc == 2:
+            s = body.decode("utf-16-be")
+        else:
+            s = body.decode("utf-8")
+    except UnicodeDecodeError:
+        s = body.decode("latin-1", "replace")
+    return s.split("\x00")[0]
+
+
+def syncsafe(b):
+    return (b[0] << 21) | (b[1] << 14) | (b[2] << 7) | b[3]
+
+
+def parse_id3v2(buf):
+    """Returns (tag_size, {'title', 'artist', 'length_ms'})."""
+    if len(buf) < 10 or buf[:3] != b"ID3":
+        return 0, {}
+    major, flags = buf[3], buf[5]
+    size = syncsafe(buf[6:10])
+    total = 10 + size + (10 if flags & 0x10 else 0)
+    tag = buf[10:10 + size]
+    pos = 0
+    if flags & 0x40 and major >= 3:
+        ext = syncsafe(tag[0:4]) if major == 4 else struct.unpack(">I", tag[0:4])[0] + 4
+        pos = ext
+    ids = {"TIT2": "title", "TT2": "title", "TPE1": "artist", "TP1": "artist", "TLEN": "length_ms", "TLE": "length_ms"}
+    out = {}
+    while pos < len(tag):
+        if major == 2:
+            if pos + 6 > len(tag):
+                break
+            fid = tag[pos:pos + 3].decode("latin-1")
+            fsize = (tag[pos + 3] << 16) | (tag[pos + 4] << 8) | tag[pos + 5]
+            pos += 6
+        else:
+            if pos + 10 > len(tag):
+                break
+            fid = tag[pos:pos + 4].decode("latin-1")
+            raw = tag[pos + 4:pos + 8]
+            fsize = syncsafe(raw) if major == 4 else struct.unpack(">I", raw)[0]
+            pos += 10
+        if not fid.strip("\x00") or fsize <= 0:
+            break
+        if fid in ids:
+            out[ids[fid]] = decode_text(tag[pos:pos + fsize])
+        pos += fsize
+    return total, out
+
+
+def parse_id3v1(tail):
+    if len(tail) < 128 or tail[-128:-125] != b"TAG":
+        return {}
+    t = tail[-128:]
+    title = t[3:33].split(b"\x00")[0].decode("latin-1").strip()
+    artist = t[33:63].split(b"\x00")[0].decode("latin-1").strip()
+    return {k: v for k, v in (("title", title), ("artist", artist)) if v}
+
+
+def frame_header(buf, pos):
+    """Decodes an MPEG audio frame header at pos, or returns None."""
+    if pos + 4 > len(buf) or buf[pos] != 0xFF or (buf[pos + 1] & 0xE0) != 0xE0:
+        return None
+    b1, b2, b3 = buf[pos + 1], buf[pos + 2], buf[pos + 3]
+    version = {0: 25, 2: 2, 3: 1}.get((b1 >> 3) & 3)
+    layer = {1: 3, 2: 2, 3: 1}.get((b1 >> 1) & 3)
+    br_idx, sr_idx = b2 >> 4, (b2 >> 2) & 3
+    if version is None or layer is None or br_idx in (0, 15) or sr_idx == 3:
+        return None
+    bitrate = BITRATES[(1 if version == 1 else 2, layer)][br_idx] * 1000
+    rate = SAMPLE_RATES[version][sr_idx]
+    pad = (b2 >> 1) & 1
+    mono = (b3 >> 6) == 3
+    if layer == 1:
+        spf, length = 384, (12 * bitrate // rate + pad) * 4
+    else:
+        spf = 1152 if layer == 2 or version == 1 else 576
+        length = spf // 8 * bitrate // rate + pad
+    return {"version": version, "bitrate": bitrate, "rate": rate, "spf": spf, "mono": mono, "length": length}
+
+
+def mp3_duration_ms(buf, start, end):
+    """First frame with a valid successor, then Xing/Info, VBRI or CBR estimate."""
+    pos = start
+    limit = min(end, start + 64 * 1024)
+    while pos < limit:
+        h = frame_header(buf, pos)
+        if h and h["length"] > 0 and frame_header(buf, pos + h["length"]):
+            break
+        pos += 1
+    else:
+        return 0
+    side = (17 if h["mono"] else 32) if h["version"] == 1 else (9 if h["mono"] else 17)
+    xing = pos + 4 + side
+    if buf[xing:xing + 4] in (b"Xing", b"Info"):
+        flags = struct.unpack(">I", buf[xing + 4:xing + 8])[0]
+        if flags & 1:
+            frames = struct.unpack(">I", buf[xing + 8:xing + 12])[0]
+            return frames * h["spf"] * 1000 // h["rate"]
+    vbri = pos + 36
+    if buf[vbri:vbri + 4] == b"VBRI":
+        frames = struct.unpack(">I", buf[vbri + 14:vbri + 18])[0]
+        return frames * h["spf"] * 1000 // h["rate"]
+    return (end - pos) * 8 * 1000 // h["bitrate"]
+
+
+def read_track(path):
+    with open(path, "rb") as f:
+        buf = f.read()
+    tag_size, info = parse_id3v2(buf)
+    v1 = parse_id3v1(buf)
+    end = len(buf) - (128 if v1 or buf[-128:-125] == b"TAG" else 0)
+    for k, v in v1.items():
+        info.setdefault(k, v)
+    length_ms = 0
+    if info.get("length_ms", "").strip().isdigit():
+        length_ms = int(info["length_ms"].strip())
+    if length_ms <= 0:
+        length_ms = mp3_duration_ms(buf, tag_size, end)
+    title = info.get("title") or ""
+    if not title.strip():
+        # "0007 Song Name.mp3" -> "Song Name"
+        stem = os.path.splitext(os.path.basename(path))[0]
+        title = re.sub(r"^\d+[\s._-]*", "", stem)
+    return to_ascii(title), to_ascii(info.get("artist") or ""), min((length_ms + 500) // 1000, 0xFFFF)
+
+
+def scan(root):
+    """Returns {folder: {file_number: path}}; folder 0 is /mp3."""
+    folders = {}
+    for entry in sorted(os.listdir(root)):
+        full = os.path.join(root, entry)
+        if not os.path.isdir(full):
+            continue
+        if entry.lower() == "mp3":
+            folder, digits = 0, 4
+        elif re.fullmatch(r"\d\d", entry) and 1 <= int(entry) <= 99:
+            folder, digits = int(entry), 3
+        else:
+            continue
+        files = {}
+        for name in os.listdir(full):
+            m = re.match(r"(\d{%d})" % digits, name)
+            if m and name.lower().endswith(".mp3") and int(m.group(1)) > 0:
+                files.setdefault(int(m.group(1)), os.path.join(full, name))
+        if files:
+            folders[folder] = files
+    return folders
+
+
+def c_string(s):
+    return '"' + s.replace("\\", "\\\\").replace('"', '\\"').replace("?", "\\?") + '\\0"'
+
+
+def build(folders):
+    pool, offsets = [], {}
+    pool_len = 0
+
+    def intern(s):
+        nonlocal pool_len
+        if s not in offsets:
+            offsets[s] = pool_len
+            pool.append(s)
+            pool_len += len(s) + 1
+        return offsets[s]
+
+    intern("")  # offset 0: gap records and unknown fields
+    artists, artist_ids = [], {}
+    records, folder_first = [], []
+    for folder in range(100):
+        folder_first.append(len(records))
+        files = folders.get(folder, {})
+        for number in range(1, (max(files) if files else 0) + 1):
+            if number not in files:
+                records.append((0, 0, 0))
+                continue
+            title, artist, seconds = read_track(files[number])
+            if artist not in artist_ids:
+                artist_ids[artist] = len(artists)
+                artists.append(intern(artist))
+            records.append((intern(title), artist_ids[artist], seconds))
+    folder_first.append(len(records))
+    return pool, pool_len, artists, records, folder_first
+
+
+def emit(out, source, pool, pool_len, artists, records, folder_first):
+    named = sum(1 for r in records if r[0])
+    total = pool_len + len(artists) * 4 + len(records) * RECORD_BYTES + len(folder_first) * 2
+    lines = [
+        "#pragma once",
+        "",
+        "// Generated by tools/make_track_index.py from %s. Do not edit;" % source,
+        "// regenerate whenever the SD card content changes.",
+        "// %d records (%d named), %d artists, %d pool bytes, %d bytes total."
+        % (len(records), named, len(artists), pool_len, total),
+        "",
+        '#include "track_index.h"',
+        "",
+        "static const uint16_t TRACK_INDEX_RECORD_COUNT = %d;" % len(records),
+        "",
+        "static const char TRACK_INDEX_POOL[] PROGMEM =",
+    ]
+    lines += ["    " + c_string(s) for s in pool]
+    lines[-1] += ";"
+    lines += ["", "static const uint32_t TRACK_INDEX_ARTISTS[] PROGMEM = {"]
+    lines += ["    %d," % a for a in artists] or ["    0,"]
+    lines += ["};", "", "static const TrackRecord TRACK_INDEX_RECORDS[] PROGMEM = {"]
+    lines += ["    {%d, %d, %d}," % r for r in records] or ["    {0, 0, 0},"]
+    lines += ["};", "", "// Folder 0 is /mp3; records of folder f are [first[f], first[f + 1]).",
+              "static const uint16_t TRACK_INDEX_FOLDER_FIRST[101] PROGMEM = {"]
+    for i in range(0, 101, 10):
+        lines.append("    " + " ".join("%d," % v for v in folder_first[i:i + 10]))
+    lines += ["};", ""]
+    out.write("\n".join(lines))
+    return named, total
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("card", nargs="?", help="SD card root directory")
+    parser.add_argument("--empty", action="store_true", help="write an index with no tracks")
+    here = os.path.dirname(os.path.abspath(__file__))
+    parser.add_argument("-o", "--output", default=os.path.join(here, "..", "firmware", "track_index_data.h"))
+    args = parser.parse_args()
+
+    if args.empty:
+        folders, args.card = {}, "an empty card"
+    elif not args.card:
+        parser.error("card directory required (or --empty)")
+    else:
+        folders = scan(args.card)
+    if not folders and not args.empty:
+        sys.exit("no /mp3 or /01../99 folders with numbered .mp3 files under %s" % args.card)
+    pool, pool_len, artists, records, folder_first = build(folders)
+    if pool_len > 0xFFFFFFFF or len(records) > 0xFFFF or len(artists) > 0xFFFF:
+        sys.exit("card too large for the index format")
+    with open(args.output, "w", newline="\n") as out:
+        named, total = emit(out, os.path.basename(os.path.abspath(args.card)) if not args.empty else args.card, pool, pool_len, artists, records, folder_first)
+    print("%s: %d records, %d named, %d bytes (%.1f per track)"
+          % (args.output, len(records), named, total, total / max(len(records), 1)))
+
+
+if __name__ == "__main__":
+    main()